@@ -0,0 +1,269 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+
+#include "xmatrix.h"
+
+// Every benchmark reports the allocations one operation makes
+// ("allocs_per_op"); data-processing ones also report bytes/s, which counts
+// each operand element read and each result element written once, and the
+// arithmetic ones "FLOPS", the nominal floating-point operations per second.
+// Pass --benchmark_out=<file> --benchmark_out_format=json to keep the results
+// for comparison with a later build.
+
+namespace {
+
+std::atomic<std::int64_t> allocations{0};
+
+void* Allocate(std::size_t size, const std::size_t alignment) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (size == 0) size = 1;
+  void* p = alignment <= alignof(std::max_align_t)
+                ? std::malloc(size)
+                : std::aligned_alloc(alignment,
+                                     (size + alignment - 1) / alignment *
+                                         alignment);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+}  // namespace
+
+// The replaced global allocation functions count every heap allocation,
+// including those of the thread pool workers.
+void* operator new(const std::size_t size) {
+  return Allocate(size, alignof(std::max_align_t));
+}
+void* operator new(const std::size_t size, const std::align_val_t alignment) {
+  return Allocate(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+using xMatrix::Matrix;
+
+Matrix RandomMatrix(const int n, const unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> dist(-1.0, 1.0);
+  Matrix m(n, n);
+  for (double& x : m) x = dist(gen);
+  return m;
+}
+
+// Runs op once per iteration and publishes the counters described above for
+// flops and bytes per operation.
+template <typename Op>
+void Measure(benchmark::State& state, const double flops, const double bytes,
+             const Op& op) {
+  const std::int64_t before = allocations.load(std::memory_order_relaxed);
+  for (auto _ : state) op();
+  const std::int64_t after = allocations.load(std::memory_order_relaxed);
+
+  state.counters["allocs_per_op"] = benchmark::Counter(
+      static_cast<double>(after - before), benchmark::Counter::kAvgIterations);
+  if (flops > 0) {
+    state.counters["FLOPS"] = benchmark::Counter(
+        flops, benchmark::Counter::kIsIterationInvariantRate);
+  }
+  if (bytes > 0) {
+    state.SetBytesProcessed(static_cast<std::int64_t>(
+        bytes * static_cast<double>(state.iterations())));
+  }
+}
+
+// Bytes in an n x n matrix.
+double MatrixBytes(const double n) { return n * n * sizeof(double); }
+
+// CONSTRUCTION AND COPIES
+
+void BM_Construct(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  Measure(state, 0, MatrixBytes(n), [n] {
+    Matrix m(n, n);
+    benchmark::DoNotOptimize(m.data());
+  });
+}
+
+void BM_Copy(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  const Matrix a = RandomMatrix(n, 1);
+  Measure(state, 0, 2 * MatrixBytes(n), [&a] {
+    Matrix m(a);
+    benchmark::DoNotOptimize(m.data());
+  });
+}
+
+// Copy assignment into a matrix of the same shape reuses its buffer.
+void BM_CopyAssign(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  const Matrix a = RandomMatrix(n, 1);
+  Matrix m(n, n);
+  Measure(state, 0, 2 * MatrixBytes(n), [&] {
+    m = a;
+    benchmark::DoNotOptimize(m.data());
+  });
+}
+
+// Moves the matrix out and back, two moves per iteration.
+void BM_Move(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  Matrix a = RandomMatrix(n, 1);
+  Measure(state, 0, 0, [&a] {
+    Matrix m(std::move(a));
+    a = std::move(m);
+    benchmark::DoNotOptimize(a.data());
+  });
+}
+
+// ELEMENT-WISE OPERATIONS
+
+void BM_SumMatrix(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  Matrix a = RandomMatrix(n, 1);
+  const Matrix b = RandomMatrix(n, 2);
+  Measure(state, static_cast<double>(n) * n, 3 * MatrixBytes(n), [&] {
+    a.SumMatrix(b);
+    benchmark::DoNotOptimize(a.data());
+  });
+}
+
+void BM_SubMatrix(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  Matrix a = RandomMatrix(n, 1);
+  const Matrix b = RandomMatrix(n, 2);
+  Measure(state, static_cast<double>(n) * n, 3 * MatrixBytes(n), [&] {
+    a.SubMatrix(b);
+    benchmark::DoNotOptimize(a.data());
+  });
+}
+
+void BM_MulNumber(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  Matrix a = RandomMatrix(n, 1);
+  Measure(state, static_cast<double>(n) * n, 2 * MatrixBytes(n), [&a] {
+    a.MulNumber(1.0000001);
+    benchmark::DoNotOptimize(a.data());
+  });
+}
+
+// c = a + b * 2 through the expression templates: one fused pass, no
+// temporaries.
+void BM_FusedExpression(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  const Matrix a = RandomMatrix(n, 1), b = RandomMatrix(n, 2);
+  Matrix c(n, n);
+  Measure(state, 2.0 * n * n, 3 * MatrixBytes(n), [&] {
+    c = a + b * 2.0;
+    benchmark::DoNotOptimize(c.data());
+  });
+}
+
+void BM_IsEqual(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  const Matrix a = RandomMatrix(n, 1), b(a);
+  Measure(state, 0, 2 * MatrixBytes(n), [&] {
+    benchmark::DoNotOptimize(a.IsEqual(b));
+  });
+}
+
+void BM_Transpose(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  const Matrix a = RandomMatrix(n, 1);
+  Measure(state, 0, 2 * MatrixBytes(n), [&a] {
+    Matrix t = a.Transpose();
+    benchmark::DoNotOptimize(t.data());
+  });
+}
+
+// PRODUCTS AND FACTORIZATIONS
+
+void BM_MulMatrix(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  const Matrix a = RandomMatrix(n, 1), b = RandomMatrix(n, 2);
+  Measure(state, 2.0 * n * n * n, 3 * MatrixBytes(n), [&] {
+    Matrix c = a * b;
+    benchmark::DoNotOptimize(c.data());
+  });
+}
+
+void BM_Determinant(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  const Matrix a = RandomMatrix(n, 1);
+  Measure(state, 2.0 / 3.0 * n * n * n, MatrixBytes(n), [&a] {
+    benchmark::DoNotOptimize(a.Determinant());
+  });
+}
+
+// LU factorization plus n solves: about 2n^3.
+void BM_InverseMatrix(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  const Matrix a = RandomMatrix(n, 1);
+  Measure(state, 2.0 * n * n * n, 2 * MatrixBytes(n), [&a] {
+    Matrix inverse = a.InverseMatrix();
+    benchmark::DoNotOptimize(inverse.data());
+  });
+}
+
+// One (n-1) x (n-1) determinant per element.
+void BM_CalcComplements(benchmark::State& state) {
+  const int n = static_cast<int>(state.range(0));
+  const Matrix a = RandomMatrix(n, 1);
+  const double minor = n - 1.0;
+  Measure(state, 2.0 / 3.0 * n * n * minor * minor * minor, 2 * MatrixBytes(n),
+          [&a] {
+            Matrix complements = a.CalcComplements();
+            benchmark::DoNotOptimize(complements.data());
+          });
+}
+
+// SIZES
+// Linear-time operations run at every power of two from 2x2 to 4096x4096,
+// cubic ones at every other, and CalcComplements, which costs O(n^5), stops
+// at 64x64.
+
+void LinearSizes(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(2)->Range(2, 4096);
+}
+
+// These run on the thread pool while the calling thread waits, so their rates
+// come from wall time rather than from the calling thread's CPU time.
+void CubicSizes(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(4)
+      ->Range(2, 4096)
+      ->Unit(benchmark::kMicrosecond)
+      ->UseRealTime();
+}
+
+BENCHMARK(BM_Construct)->Apply(LinearSizes);
+BENCHMARK(BM_Copy)->Apply(LinearSizes);
+BENCHMARK(BM_CopyAssign)->Apply(LinearSizes);
+BENCHMARK(BM_Move)->Apply(LinearSizes);
+BENCHMARK(BM_SumMatrix)->Apply(LinearSizes);
+BENCHMARK(BM_SubMatrix)->Apply(LinearSizes);
+BENCHMARK(BM_MulNumber)->Apply(LinearSizes);
+BENCHMARK(BM_FusedExpression)->Apply(LinearSizes);
+BENCHMARK(BM_IsEqual)->Apply(LinearSizes);
+BENCHMARK(BM_Transpose)->Apply(LinearSizes);
+BENCHMARK(BM_MulMatrix)->Apply(CubicSizes);
+BENCHMARK(BM_Determinant)->Apply(CubicSizes);
+BENCHMARK(BM_InverseMatrix)->Apply(CubicSizes);
+BENCHMARK(BM_CalcComplements)
+    ->RangeMultiplier(2)
+    ->Range(2, 64)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,74 @@
+#ifndef XMATRIX_ALIGNED_ALLOCATOR_H
+#define XMATRIX_ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+
+#include "instrumentation.h"
+
+namespace xMatrix {
+
+// Matrix storage starts on a cache-line boundary, which is also the widest
+// SIMD register, so the first row never splits a line.
+constexpr std::size_t kMatrixAlignment = 64;
+
+// Allocator behind Matrix storage: requests kMatrixAlignment-aligned blocks
+// from a std::pmr::memory_resource, so huge-page, NUMA-local or arena
+// allocators plug in without changing the Matrix type. Like
+// std::pmr::polymorphic_allocator a copy takes the current default resource,
+// but a move hands the buffer over together with its resource so moving a
+// matrix never copies elements.
+template <typename T>
+class AlignedAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  AlignedAllocator() noexcept : resource_(std::pmr::get_default_resource()) {}
+  explicit AlignedAllocator(std::pmr::memory_resource* resource) noexcept
+      : resource_(resource) {}
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U>& o) noexcept  // NOLINT
+      : resource_(o.GetResource()) {}
+
+  [[nodiscard]] T* allocate(const std::size_t n) {
+#if defined(XMATRIX_INSTRUMENTATION)
+    internal::RecordAllocation(n * sizeof(T));
+#endif
+    return static_cast<T*>(resource_->allocate(n * sizeof(T), kAlignment));
+  }
+
+  void deallocate(T* p, const std::size_t n) noexcept {
+    resource_->deallocate(p, n * sizeof(T), kAlignment);
+  }
+
+  [[nodiscard]] AlignedAllocator select_on_container_copy_construction()
+      const {
+    return AlignedAllocator();
+  }
+
+  [[nodiscard]] std::pmr::memory_resource* GetResource() const {
+    return resource_;
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U>& o) const noexcept {
+    return *resource_ == *o.GetResource();
+  }
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U>& o) const noexcept {
+    return !(*this == o);
+  }
+
+ private:
+  static constexpr std::size_t kAlignment =
+      alignof(T) > kMatrixAlignment ? alignof(T) : kMatrixAlignment;
+
+  std::pmr::memory_resource* resource_;
+};
+
+}  // namespace xMatrix
+#endif  // XMATRIX_ALIGNED_ALLOCATOR_H
@@ -0,0 +1,239 @@
+#ifndef XMATRIX_FIXED_MATRIX_H
+#define XMATRIX_FIXED_MATRIX_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+
+#include "xmatrix.h"
+
+namespace xMatrix {
+
+// Matrix with dimensions known at compile time and inline row-major storage.
+// Meant for 2x2..4x4 transforms: it never allocates, every loop has a
+// constant trip count, and the 2x2, 3x3 and 4x4 determinant and inverse are
+// written out in closed form. Element access is unchecked.
+template <int R, int C, typename T = double>
+class FixedMatrix {
+  static_assert(R > 0 && C > 0, "FixedMatrix dimensions must be positive");
+
+ public:
+  using ValueType = T;
+
+  constexpr FixedMatrix() : data_{} {}
+
+  // Row-major values; missing trailing values are zero.
+  constexpr FixedMatrix(std::initializer_list<T> values) : data_{} {
+    if (values.size() > static_cast<size_t>(R * C)) {
+      throw std::invalid_argument("Too many values for the matrix size");
+    }
+
+    int i = 0;
+    for (const T value : values) data_[i++] = value;
+  }
+
+  explicit FixedMatrix(const Matrix& m) : data_{} {
+    if (m.GetRows() != R || m.GetCols() != C) {
+      throw std::invalid_argument("Matrices are not of the same size");
+    }
+
+    for (int i = 0; i < R * C; i++) data_[i] = static_cast<T>(m.data()[i]);
+  }
+
+  static constexpr FixedMatrix Identity() {
+    static_assert(R == C, "Identity matrix must be square");
+
+    FixedMatrix result;
+    for (int i = 0; i < R; i++) result.data_[i * C + i] = T(1);
+    return result;
+  }
+
+  [[nodiscard]] static constexpr int GetRows() { return R; }
+  [[nodiscard]] static constexpr int GetCols() { return C; }
+
+  constexpr T& operator()(const int r, const int c) { return data_[r * C + c]; }
+  constexpr const T& operator()(const int r, const int c) const {
+    return data_[r * C + c];
+  }
+
+  [[nodiscard]] Matrix ToMatrix() const {
+    Matrix result(R, C);
+    for (int i = 0; i < R * C; i++)
+      result.data()[i] = static_cast<double>(data_[i]);
+    return result;
+  }
+
+  [[nodiscard]] constexpr bool IsEqual(const FixedMatrix& other) const {
+    for (int i = 0; i < R * C; i++) {
+      const T diff = data_[i] - other.data_[i];
+      if ((diff < T(0) ? -diff : diff) >= T(EPS)) return false;
+    }
+    return true;
+  }
+
+  [[nodiscard]] constexpr FixedMatrix<C, R, T> Transpose() const {
+    FixedMatrix<C, R, T> result;
+    for (int i = 0; i < R; i++)
+      for (int j = 0; j < C; j++) result(j, i) = (*this)(i, j);
+    return result;
+  }
+
+  [[nodiscard]] constexpr T Determinant() const {
+    static_assert(R == C && R <= 4,
+                  "Determinant is provided for square matrices up to 4x4");
+    const T* m = data_;
+
+    if constexpr (R == 1) {
+      return m[0];
+    } else if constexpr (R == 2) {
+      return m[0] * m[3] - m[1] * m[2];
+    } else if constexpr (R == 3) {
+      return m[0] * (m[4] * m[8] - m[5] * m[7]) -
+             m[1] * (m[3] * m[8] - m[5] * m[6]) +
+             m[2] * (m[3] * m[7] - m[4] * m[6]);
+    } else {
+      const Minors4 s = Minors();
+      return s.lo[0] * s.hi[5] - s.lo[1] * s.hi[4] + s.lo[2] * s.hi[3] +
+             s.lo[3] * s.hi[2] - s.lo[4] * s.hi[1] + s.lo[5] * s.hi[0];
+    }
+  }
+
+  [[nodiscard]] constexpr FixedMatrix InverseMatrix() const {
+    static_assert(R == C && R <= 4,
+                  "InverseMatrix is provided for square matrices up to 4x4");
+    const T* m = data_;
+    FixedMatrix result;
+    T* r = result.data_;
+    T det{};
+
+    if constexpr (R == 1) {
+      det = m[0];
+      r[0] = T(1);
+    } else if constexpr (R == 2) {
+      det = Determinant();
+      r[0] = m[3];
+      r[1] = -m[1];
+      r[2] = -m[2];
+      r[3] = m[0];
+    } else if constexpr (R == 3) {
+      r[0] = m[4] * m[8] - m[5] * m[7];
+      r[1] = m[2] * m[7] - m[1] * m[8];
+      r[2] = m[1] * m[5] - m[2] * m[4];
+      r[3] = m[5] * m[6] - m[3] * m[8];
+      r[4] = m[0] * m[8] - m[2] * m[6];
+      r[5] = m[2] * m[3] - m[0] * m[5];
+      r[6] = m[3] * m[7] - m[4] * m[6];
+      r[7] = m[1] * m[6] - m[0] * m[7];
+      r[8] = m[0] * m[4] - m[1] * m[3];
+      det = m[0] * r[0] + m[1] * r[3] + m[2] * r[6];
+    } else {
+      const Minors4 s = Minors();
+      const T* lo = s.lo;
+      const T* hi = s.hi;
+      r[0] = m[5] * hi[5] - m[6] * hi[4] + m[7] * hi[3];
+      r[1] = -m[1] * hi[5] + m[2] * hi[4] - m[3] * hi[3];
+      r[2] = m[13] * lo[5] - m[14] * lo[4] + m[15] * lo[3];
+      r[3] = -m[9] * lo[5] + m[10] * lo[4] - m[11] * lo[3];
+      r[4] = -m[4] * hi[5] + m[6] * hi[2] - m[7] * hi[1];
+      r[5] = m[0] * hi[5] - m[2] * hi[2] + m[3] * hi[1];
+      r[6] = -m[12] * lo[5] + m[14] * lo[2] - m[15] * lo[1];
+      r[7] = m[8] * lo[5] - m[10] * lo[2] + m[11] * lo[1];
+      r[8] = m[4] * hi[4] - m[5] * hi[2] + m[7] * hi[0];
+      r[9] = -m[0] * hi[4] + m[1] * hi[2] - m[3] * hi[0];
+      r[10] = m[12] * lo[4] - m[13] * lo[2] + m[15] * lo[0];
+      r[11] = -m[8] * lo[4] + m[9] * lo[2] - m[11] * lo[0];
+      r[12] = -m[4] * hi[3] + m[5] * hi[1] - m[6] * hi[0];
+      r[13] = m[0] * hi[3] - m[1] * hi[1] + m[2] * hi[0];
+      r[14] = -m[12] * lo[3] + m[13] * lo[1] - m[14] * lo[0];
+      r[15] = m[8] * lo[3] - m[9] * lo[1] + m[10] * lo[0];
+      det = lo[0] * hi[5] - lo[1] * hi[4] + lo[2] * hi[3] + lo[3] * hi[2] -
+            lo[4] * hi[1] + lo[5] * hi[0];
+    }
+
+    // Like Matrix::InverseMatrix(), only an exactly singular matrix is
+    // rejected; a tiny determinant such as that of diag(1e-17, 1) is not.
+    if (det == T(0)) {
+      throw std::invalid_argument("Determinant is equal to zero");
+    }
+
+    const T inv_det = T(1) / det;
+    for (int i = 0; i < R * C; i++) r[i] *= inv_det;
+
+    return result;
+  }
+
+  constexpr FixedMatrix& operator+=(const FixedMatrix& other) {
+    for (int i = 0; i < R * C; i++) data_[i] += other.data_[i];
+    return *this;
+  }
+
+  constexpr FixedMatrix& operator-=(const FixedMatrix& other) {
+    for (int i = 0; i < R * C; i++) data_[i] -= other.data_[i];
+    return *this;
+  }
+
+  constexpr FixedMatrix& operator*=(const T num) {
+    for (int i = 0; i < R * C; i++) data_[i] *= num;
+    return *this;
+  }
+
+  constexpr FixedMatrix& operator*=(const FixedMatrix<C, C, T>& other) {
+    return *this = *this * other;
+  }
+
+  friend constexpr FixedMatrix operator+(FixedMatrix l, const FixedMatrix& r) {
+    return l += r;
+  }
+
+  friend constexpr FixedMatrix operator-(FixedMatrix l, const FixedMatrix& r) {
+    return l -= r;
+  }
+
+  friend constexpr FixedMatrix operator*(FixedMatrix m, const T num) {
+    return m *= num;
+  }
+
+  friend constexpr FixedMatrix operator*(const T num, FixedMatrix m) {
+    return m *= num;
+  }
+
+  template <int K>
+  friend constexpr FixedMatrix<R, K, T> operator*(
+      const FixedMatrix& l, const FixedMatrix<C, K, T>& r) {
+    FixedMatrix<R, K, T> result;
+    for (int i = 0; i < R; i++) {
+      for (int f = 0; f < C; f++) {
+        const T l_if = l(i, f);
+        for (int j = 0; j < K; j++) result(i, j) += l_if * r(f, j);
+      }
+    }
+    return result;
+  }
+
+  constexpr bool operator==(const FixedMatrix& other) const {
+    return IsEqual(other);
+  }
+
+ private:
+  // 2x2 minors of the top two rows (lo) and the bottom two rows (hi) of a
+  // 4x4 matrix; the determinant and adjugate are built from these twelve.
+  struct Minors4 {
+    T lo[6];
+    T hi[6];
+  };
+
+  constexpr Minors4 Minors() const {
+    const T* m = data_;
+    return {{m[0] * m[5] - m[1] * m[4], m[0] * m[6] - m[2] * m[4],
+             m[0] * m[7] - m[3] * m[4], m[1] * m[6] - m[2] * m[5],
+             m[1] * m[7] - m[3] * m[5], m[2] * m[7] - m[3] * m[6]},
+            {m[8] * m[13] - m[9] * m[12], m[8] * m[14] - m[10] * m[12],
+             m[8] * m[15] - m[11] * m[12], m[9] * m[14] - m[10] * m[13],
+             m[9] * m[15] - m[11] * m[13], m[10] * m[15] - m[11] * m[14]}};
+  }
+
+  T data_[R * C];
+};
+
+}  // namespace xMatrix
+#endif  // XMATRIX_FIXED_MATRIX_H
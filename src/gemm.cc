@@ -0,0 +1,398 @@
+#include "gemm.h"
+
+#include <algorithm>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+#include "scratch_pool.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#if defined(XMATRIX_X86_DISPATCH)
+#include <immintrin.h>
+#endif
+
+namespace xMatrix {
+namespace internal {
+
+namespace {
+
+// Register tile of the portable micro-kernel: MR x NR accumulators stay in
+// registers for the whole k loop. The vector kernels below use larger tiles.
+constexpr int kMR = 4;
+constexpr int kNR = 8;
+
+// Below this many multiply-adds packing costs more than it saves.
+constexpr long kSmallProduct = 32L * 32L * 32L;
+
+// Below this many multiply-adds waking the thread pool costs more than it
+// saves.
+constexpr long kParallelProduct = 128L * 128L * 128L;
+
+// c[i * rs + j * cs] += sum over p of a[p * mr + i] * b[p * nr + j] for the
+// top-left rows x cols of an mr x nr tile, where a and b are packed slivers.
+template <typename T>
+using MicroKernelFn = void (*)(int kc, const T* a, const T* b, T* c,
+                               std::ptrdiff_t rs, std::ptrdiff_t cs, int rows,
+                               int cols);
+
+// Micro-kernel picked for this process and the tile it computes.
+template <typename T>
+struct MicroKernelConfig {
+  MicroKernelFn<T> kernel;
+  int mr;
+  int nr;
+};
+
+struct Blocking {
+  int kc;  // depth of a packed panel, an NR-wide B sliver fills half of L1
+  int mc;  // rows of a packed A block, sized to half of L2
+  int nc;  // cols of a packed B panel, sized to half of L3
+};
+
+// Size in bytes of the data cache at the given level (1..3).
+long CacheSize(const int level, const long fallback) {
+#if defined(_SC_LEVEL1_DCACHE_SIZE)
+  const int names[] = {_SC_LEVEL1_DCACHE_SIZE, _SC_LEVEL2_CACHE_SIZE,
+                       _SC_LEVEL3_CACHE_SIZE};
+  const long size = sysconf(names[level - 1]);
+  if (size > 0) return size;
+#else
+  (void)level;
+#endif
+  return fallback;
+}
+
+template <typename T>
+Blocking ComputeBlocking(const int mr, const int nr) {
+  const long l1 = CacheSize(1, 32L << 10);
+  const long l2 = CacheSize(2, 256L << 10);
+  const long l3 = CacheSize(3, 8L << 20);
+  constexpr long kElement = sizeof(T);
+
+  Blocking blocking{};
+  blocking.kc = static_cast<int>(
+      std::clamp(l1 / 2 / (nr * kElement), 64L, 512L));
+  blocking.mc = static_cast<int>(
+      std::clamp(l2 / 2 / (blocking.kc * kElement), 4L * mr, 512L) / mr * mr);
+  blocking.nc = static_cast<int>(
+      std::clamp(l3 / 2 / (blocking.kc * kElement), 256L, 8192L) / nr * nr);
+
+  return blocking;
+}
+
+// Copies an mc x kc block of A into mr-row slivers laid out column by column,
+// zero-padding the last sliver. The loop order follows A's layout so that the
+// source is always read along its unit stride: row by row for a plain matrix,
+// column by column for a transposed view.
+template <typename T>
+void PackA(const int mr, const int mc, const int kc, const T* a,
+           const std::ptrdiff_t rs, const std::ptrdiff_t cs, T* packed) {
+  for (int i = 0; i < mc; i += mr) {
+    const int rows = std::min(mr, mc - i);
+
+    if (cs == 1) {
+      for (int r = 0; r < rows; r++) {
+        const T* row = a + (i + r) * rs;
+        for (int p = 0; p < kc; p++) packed[p * mr + r] = row[p];
+      }
+      for (int r = rows; r < mr; r++)
+        for (int p = 0; p < kc; p++) packed[p * mr + r] = T();
+      packed += kc * mr;
+      continue;
+    }
+
+    for (int p = 0; p < kc; p++) {
+      for (int r = 0; r < rows; r++) packed[r] = a[(i + r) * rs + p * cs];
+      for (int r = rows; r < mr; r++) packed[r] = T();
+      packed += mr;
+    }
+  }
+}
+
+// Copies a kc x nc panel of B into nr-col slivers laid out row by row, so the
+// micro-kernel streams B contiguously. A transposed B (unit row stride) is
+// read column by column instead.
+template <typename T>
+void PackB(const int nr, const int kc, const int nc, const T* b,
+           const std::ptrdiff_t rs, const std::ptrdiff_t cs, T* packed) {
+  for (int j = 0; j < nc; j += nr) {
+    const int cols = std::min(nr, nc - j);
+
+    if (rs == 1 && cs != 1) {
+      for (int c = 0; c < cols; c++) {
+        const T* col = b + (j + c) * cs;
+        for (int p = 0; p < kc; p++) packed[p * nr + c] = col[p];
+      }
+      for (int c = cols; c < nr; c++)
+        for (int p = 0; p < kc; p++) packed[p * nr + c] = T();
+      packed += kc * nr;
+      continue;
+    }
+
+    for (int p = 0; p < kc; p++) {
+      const T* row = b + p * rs + j * cs;
+      for (int c = 0; c < cols; c++) packed[c] = row[c * cs];
+      for (int c = cols; c < nr; c++) packed[c] = T();
+      packed += nr;
+    }
+  }
+}
+
+template <typename T>
+void MicroKernel(const int kc, const T* a, const T* b, T* c,
+                 const std::ptrdiff_t rs, const std::ptrdiff_t cs,
+                 const int rows, const int cols) {
+  T acc[kMR][kNR] = {};
+
+  for (int p = 0; p < kc; p++) {
+    for (int i = 0; i < kMR; i++) {
+      const T a_ip = a[i];
+      for (int j = 0; j < kNR; j++) acc[i][j] += a_ip * b[j];
+    }
+    a += kMR;
+    b += kNR;
+  }
+
+  for (int i = 0; i < rows; i++)
+    for (int j = 0; j < cols; j++) c[i * rs + j * cs] += acc[i][j];
+}
+
+#if defined(XMATRIX_X86_DISPATCH)
+
+// Vector micro-kernels: MR rows of NV registers of B, i.e. MR * NV
+// accumulators, sized so that they plus the NV B registers and the broadcast
+// of A fit the register file (16 ymm for AVX2, 32 zmm for AVX-512). Full
+// tiles of a row-major C are updated straight from the registers; edge tiles
+// go through a local buffer.
+#define XMATRIX_DEFINE_MICRO_KERNEL(NAME, TARGET, TYPE, VEC, WIDTH, MR, NV, \
+                                    LOADU, STOREU, SET1, FMA, ADD, ZERO)    \
+  __attribute__((target(TARGET))) void NAME(                                \
+      const int kc, const TYPE* a, const TYPE* b, TYPE* c,                  \
+      const std::ptrdiff_t rs, const std::ptrdiff_t cs, const int rows,     \
+      const int cols) {                                                     \
+    VEC acc[MR][NV];                                                        \
+    _Pragma("GCC unroll 16") for (int i = 0; i < MR; i++)                   \
+        _Pragma("GCC unroll 4") for (int v = 0; v < NV; v++)                \
+            acc[i][v] = ZERO();                                             \
+                                                                            \
+    for (int p = 0; p < kc; p++) {                                          \
+      VEC bv[NV];                                                           \
+      _Pragma("GCC unroll 4") for (int v = 0; v < NV; v++)                  \
+          bv[v] = LOADU(b + v * WIDTH);                                     \
+      _Pragma("GCC unroll 16") for (int i = 0; i < MR; i++) {               \
+        const VEC ai = SET1(a[i]);                                          \
+        _Pragma("GCC unroll 4") for (int v = 0; v < NV; v++)                \
+            acc[i][v] = FMA(ai, bv[v], acc[i][v]);                          \
+      }                                                                     \
+      a += MR;                                                              \
+      b += NV * WIDTH;                                                      \
+    }                                                                       \
+                                                                            \
+    if (rows == MR && cols == NV * WIDTH && cs == 1) {                      \
+      _Pragma("GCC unroll 16") for (int i = 0; i < MR; i++)                 \
+          _Pragma("GCC unroll 4") for (int v = 0; v < NV; v++) {            \
+        TYPE* out = c + i * rs + v * WIDTH;                                 \
+        STOREU(out, ADD(LOADU(out), acc[i][v]));                            \
+      }                                                                     \
+      return;                                                               \
+    }                                                                       \
+                                                                            \
+    TYPE tile[MR][NV * WIDTH];                                              \
+    for (int i = 0; i < MR; i++)                                            \
+      for (int v = 0; v < NV; v++) STOREU(tile[i] + v * WIDTH, acc[i][v]);  \
+    for (int i = 0; i < rows; i++)                                          \
+      for (int j = 0; j < cols; j++) c[i * rs + j * cs] += tile[i][j];      \
+  }
+
+// 6 x 8 doubles and 6 x 16 floats: 12 ymm accumulators.
+XMATRIX_DEFINE_MICRO_KERNEL(MicroKernelAvx2, "avx2,fma", double, __m256d, 4, 6,
+                            2, _mm256_loadu_pd, _mm256_storeu_pd,
+                            _mm256_set1_pd, _mm256_fmadd_pd, _mm256_add_pd,
+                            _mm256_setzero_pd)
+XMATRIX_DEFINE_MICRO_KERNEL(MicroKernelAvx2, "avx2,fma", float, __m256, 8, 6,
+                            2, _mm256_loadu_ps, _mm256_storeu_ps,
+                            _mm256_set1_ps, _mm256_fmadd_ps, _mm256_add_ps,
+                            _mm256_setzero_ps)
+// 8 x 16 doubles and 8 x 32 floats: 16 zmm accumulators.
+XMATRIX_DEFINE_MICRO_KERNEL(MicroKernelAvx512, "avx512f", double, __m512d, 8,
+                            8, 2, _mm512_loadu_pd, _mm512_storeu_pd,
+                            _mm512_set1_pd, _mm512_fmadd_pd, _mm512_add_pd,
+                            _mm512_setzero_pd)
+XMATRIX_DEFINE_MICRO_KERNEL(MicroKernelAvx512, "avx512f", float, __m512, 16,
+                            8, 2, _mm512_loadu_ps, _mm512_storeu_ps,
+                            _mm512_set1_ps, _mm512_fmadd_ps, _mm512_add_ps,
+                            _mm512_setzero_ps)
+#undef XMATRIX_DEFINE_MICRO_KERNEL
+
+#endif
+
+// Picks the widest kernel the instruction set chosen in simd.h allows; the
+// AVX2 kernels also need FMA. Types without vector kernels use the portable
+// one.
+template <typename T>
+MicroKernelConfig<T> SelectMicroKernel() {
+#if defined(XMATRIX_X86_DISPATCH)
+  if constexpr (std::is_same_v<T, double> || std::is_same_v<T, float>) {
+    constexpr int kLanes = 64 / sizeof(T);
+    switch (GetSimdLevel()) {
+      case SimdLevel::kAvx512:
+        return {MicroKernelAvx512, 8, kLanes * 2};
+      case SimdLevel::kAvx2:
+        if (__builtin_cpu_supports("fma")) {
+          return {MicroKernelAvx2, 6, kLanes};
+        }
+        break;
+      default:
+        break;
+    }
+  }
+#endif
+  return {MicroKernel<T>, kMR, kNR};
+}
+
+template <typename T>
+struct GemmSetup {
+  MicroKernelConfig<T> micro;
+  Blocking blocking;
+};
+
+template <typename T>
+const GemmSetup<T>& GetSetup() {
+  static const GemmSetup<T> setup = [] {
+    const MicroKernelConfig<T> micro = SelectMicroKernel<T>();
+    return GemmSetup<T>{micro, ComputeBlocking<T>(micro.mr, micro.nr)};
+  }();
+  return setup;
+}
+
+template <typename T>
+void GemmSmall(const BasicMatrixView<const T>& a,
+               const BasicMatrixView<const T>& b, const BasicMatrixView<T>& c) {
+  const int m = a.GetRows(), k = a.GetCols(), n = b.GetCols();
+
+  // A * B^T: rows of A meet rows of the untransposed B, so every element of
+  // C is a dot product of two contiguous runs.
+  if (a.GetColStride() == 1 && b.GetRowStride() == 1) {
+    for (int i = 0; i < m; i++) {
+      const T* a_row = a.data() + i * a.GetRowStride();
+      for (int j = 0; j < n; j++) {
+        const T* b_col = b.data() + j * b.GetColStride();
+        T sum = T();
+        for (int p = 0; p < k; p++) sum += a_row[p] * b_col[p];
+        c.data()[i * c.GetRowStride() + j * c.GetColStride()] += sum;
+      }
+    }
+    return;
+  }
+
+  // A * B and A^T * B: C is updated row by row from contiguous rows of B.
+  if (b.GetColStride() == 1 && c.GetColStride() == 1) {
+    for (int i = 0; i < m; i++) {
+      T* c_row = c.data() + i * c.GetRowStride();
+      for (int p = 0; p < k; p++) {
+        const T a_ip = a.data()[i * a.GetRowStride() + p * a.GetColStride()];
+        const T* b_row = b.data() + p * b.GetRowStride();
+        for (int j = 0; j < n; j++) c_row[j] += a_ip * b_row[j];
+      }
+    }
+    return;
+  }
+
+  // A^T * B^T and other strided layouts.
+  for (int i = 0; i < m; i++)
+    for (int p = 0; p < k; p++)
+      for (int j = 0; j < n; j++)
+        c.data()[i * c.GetRowStride() + j * c.GetColStride()] +=
+            a.data()[i * a.GetRowStride() + p * a.GetColStride()] *
+            b.data()[p * b.GetRowStride() + j * b.GetColStride()];
+}
+
+}  // namespace
+
+template <typename T>
+void Gemm(const BasicMatrixView<const T> a, const BasicMatrixView<const T> b,
+          const BasicMatrixView<T> c) {
+  const int m = a.GetRows(), k = a.GetCols(), n = b.GetCols();
+
+  if (static_cast<long>(m) * n * k <= kSmallProduct) {
+    GemmSmall(a, b, c);
+    return;
+  }
+
+  const GemmSetup<T>& setup = GetSetup<T>();
+  const Blocking& blocking = setup.blocking;
+  const MicroKernelFn<T> kernel = setup.micro.kernel;
+  const int mr = setup.micro.mr, nr = setup.micro.nr;
+  ThreadPool& pool = ThreadPool::Instance();
+  const bool parallel = static_cast<long>(m) * n * k >= kParallelProduct &&
+                        pool.GetNumThreads() > 1;
+
+  // Row blocks of C are the unit of parallel work; shrink them so that every
+  // thread gets at least one.
+  int mc_step = blocking.mc;
+  if (parallel) {
+    const int threads = pool.GetNumThreads();
+    const int per_thread = (m + threads - 1) / threads;
+    mc_step = std::clamp((per_thread + mr - 1) / mr * mr, mr, blocking.mc);
+  }
+  const int row_blocks = (m + mc_step - 1) / mc_step;
+
+  const int kc_max = std::min(blocking.kc, k);
+  const int nc_max = std::min(blocking.nc, (n + nr - 1) / nr * nr);
+  std::pmr::vector<T> packed_b(static_cast<size_t>(kc_max) * nc_max,
+                               ScratchResource());
+
+  for (int jc = 0; jc < n; jc += blocking.nc) {
+    const int nc = std::min(blocking.nc, n - jc);
+
+    for (int pc = 0; pc < k; pc += blocking.kc) {
+      const int kc = std::min(blocking.kc, k - pc);
+      PackB(nr, kc, nc,
+            b.data() + pc * b.GetRowStride() + jc * b.GetColStride(),
+            b.GetRowStride(), b.GetColStride(), packed_b.data());
+
+      const auto row_block = [&](const int block) {
+        const int ic = block * mc_step;
+        const int mc = std::min(mc_step, m - ic);
+
+        thread_local std::vector<T> packed_a;
+        const size_t packed_size = static_cast<size_t>(mc_step) * kc_max;
+        if (packed_a.size() < packed_size) packed_a.resize(packed_size);
+        PackA(mr, mc, kc,
+              a.data() + ic * a.GetRowStride() + pc * a.GetColStride(),
+              a.GetRowStride(), a.GetColStride(), packed_a.data());
+
+        for (int jr = 0; jr < nc; jr += nr) {
+          for (int ir = 0; ir < mc; ir += mr) {
+            kernel(kc, packed_a.data() + ir * kc, packed_b.data() + jr * kc,
+                   c.data() + (ic + ir) * c.GetRowStride() +
+                       (jc + jr) * c.GetColStride(),
+                   c.GetRowStride(), c.GetColStride(), std::min(mr, mc - ir),
+                   std::min(nr, nc - jr));
+          }
+        }
+      };
+
+      if (parallel) {
+        pool.ParallelFor(row_blocks, row_block);
+      } else {
+        for (int block = 0; block < row_blocks; block++) row_block(block);
+      }
+    }
+  }
+}
+
+#define XMATRIX_INSTANTIATE_GEMM(T)                                     \
+  template void Gemm(BasicMatrixView<const T> a, BasicMatrixView<const T> b, \
+                     BasicMatrixView<T> c);
+XMATRIX_FOR_EACH_SCALAR(XMATRIX_INSTANTIATE_GEMM)
+#undef XMATRIX_INSTANTIATE_GEMM
+
+}  // namespace internal
+}  // namespace xMatrix
@@ -0,0 +1,19 @@
+#ifndef XMATRIX_GEMM_H
+#define XMATRIX_GEMM_H
+
+#include "matrix_view.h"
+
+namespace xMatrix {
+namespace internal {
+
+// C += A * B, where A is m x k, B is k x n and C is m x n. Operands may have
+// any row and column strides; packing turns them into contiguous panels, so a
+// transposed view (unit row stride) is as cheap as a plain matrix.
+// Instantiated for every type in XMATRIX_FOR_EACH_SCALAR.
+template <typename T>
+void Gemm(BasicMatrixView<const T> a, BasicMatrixView<const T> b,
+          BasicMatrixView<T> c);
+
+}  // namespace internal
+}  // namespace xMatrix
+#endif  // XMATRIX_GEMM_H
@@ -0,0 +1,224 @@
+#include "instrumentation.h"
+
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace xMatrix {
+
+namespace {
+
+using internal::OperationCounters;
+
+constexpr const char* kOperationNames[] = {
+    "Construct",
+    "Copy",
+    "Move",
+    "Evaluate",
+    "Resize",
+    "IsEqual",
+    "SumMatrix",
+    "SubMatrix",
+    "MulNumber",
+    "MulMatrix",
+    "Transpose",
+    "TransposeInPlace",
+    "CalcComplements",
+    "Determinant",
+    "InverseMatrix",
+    "LU",
+    "LUFactors",
+    "Solve",
+    "ReciprocalCondition",
+    "SolveMixedPrecision",
+    "PrintMatrix",
+    "Save",
+    "Load",
+};
+
+static_assert(std::size(kOperationNames) == kOperationCount,
+              "every Operation needs a name");
+
+// Counters of the outermost tracked call running on this thread, if any.
+thread_local OperationCounters* current_operation = nullptr;
+
+void Increment(std::atomic<std::uint64_t>& counter, const std::uint64_t n) {
+  counter.store(counter.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+}
+
+void Accumulate(const OperationCounters& from, OperationStats& to) {
+  to.calls += from.calls.load(std::memory_order_relaxed);
+  to.nanoseconds += from.nanoseconds.load(std::memory_order_relaxed);
+  to.flops += from.flops.load(std::memory_order_relaxed);
+  to.allocations += from.allocations.load(std::memory_order_relaxed);
+  to.bytes_allocated += from.bytes_allocated.load(std::memory_order_relaxed);
+  for (int b = 0; b < kLatencyBuckets; b++)
+    to.latency[b] += from.latency[b].load(std::memory_order_relaxed);
+}
+
+void Subtract(const OperationStats& base, OperationStats& stats) {
+  stats.calls -= base.calls;
+  stats.nanoseconds -= base.nanoseconds;
+  stats.flops -= base.flops;
+  stats.allocations -= base.allocations;
+  stats.bytes_allocated -= base.bytes_allocated;
+  for (int b = 0; b < kLatencyBuckets; b++) stats.latency[b] -= base.latency[b];
+}
+
+int LatencyBucket(std::uint64_t nanoseconds) {
+  int bucket = 0;
+  while (nanoseconds != 0 && bucket < kLatencyBuckets - 1) {
+    nanoseconds >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+struct ThreadCounters {
+  std::array<OperationCounters, kOperationCount> operations;
+};
+
+// Every thread's counters plus the totals of threads that have exited. A
+// snapshot is the sum of both minus the baseline taken by the last reset.
+class Registry {
+ public:
+  static Registry& Instance() {
+    // Never destroyed: thread pool workers still fold their counters in
+    // while static objects are torn down.
+    static Registry* registry = new Registry;
+    return *registry;
+  }
+
+  void Add(const ThreadCounters* counters) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    threads_.push_back(counters);
+  }
+
+  void Remove(const ThreadCounters* counters) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    for (int op = 0; op < kOperationCount; op++)
+      Accumulate(counters->operations[op], exited_.operations[op]);
+    threads_.erase(std::find(threads_.begin(), threads_.end(), counters));
+  }
+
+  InstrumentationSnapshot Snapshot() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    InstrumentationSnapshot snapshot = Totals();
+    for (int op = 0; op < kOperationCount; op++)
+      Subtract(baseline_.operations[op], snapshot.operations[op]);
+    return snapshot;
+  }
+
+  void Reset() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    baseline_ = Totals();
+  }
+
+ private:
+  Registry() = default;
+
+  InstrumentationSnapshot Totals() const {
+    InstrumentationSnapshot totals = exited_;
+    for (const ThreadCounters* counters : threads_)
+      for (int op = 0; op < kOperationCount; op++)
+        Accumulate(counters->operations[op], totals.operations[op]);
+    return totals;
+  }
+
+  std::mutex mutex_;
+  std::vector<const ThreadCounters*> threads_;
+  InstrumentationSnapshot exited_{};
+  InstrumentationSnapshot baseline_{};
+};
+
+// Registers the thread's counters on first use and hands their totals to the
+// registry when the thread exits.
+class LocalCounters {
+ public:
+  LocalCounters() { Registry::Instance().Add(&counters_); }
+  LocalCounters(const LocalCounters&) = delete;
+  LocalCounters& operator=(const LocalCounters&) = delete;
+  ~LocalCounters() { Registry::Instance().Remove(&counters_); }
+
+  ThreadCounters& Get() { return counters_; }
+
+ private:
+  ThreadCounters counters_;
+};
+
+ThreadCounters& Counters() {
+  thread_local LocalCounters counters;
+  return counters.Get();
+}
+
+}  // namespace
+
+InstrumentationSnapshot GetInstrumentationSnapshot() {
+  return Registry::Instance().Snapshot();
+}
+
+void ResetInstrumentation() { Registry::Instance().Reset(); }
+
+const char* GetOperationName(const Operation op) {
+  return kOperationNames[static_cast<int>(op)];
+}
+
+void DumpInstrumentation(std::ostream& out) {
+  const InstrumentationSnapshot snapshot = GetInstrumentationSnapshot();
+
+  for (int op = 0; op < kOperationCount; op++) {
+    const OperationStats& stats = snapshot.operations[op];
+    if (stats.calls == 0) continue;
+
+    out << kOperationNames[op] << " calls=" << stats.calls
+        << " ns=" << stats.nanoseconds << " flops=" << stats.flops
+        << " allocations=" << stats.allocations
+        << " bytes=" << stats.bytes_allocated << " latency_ns=";
+    const char* separator = "";
+    for (int b = 0; b < kLatencyBuckets; b++) {
+      if (stats.latency[b] == 0) continue;
+      out << separator << '<' << (std::uint64_t{1} << b) << ':'
+          << stats.latency[b];
+      separator = ",";
+    }
+    out << '\n';
+  }
+}
+
+namespace internal {
+
+ScopedOperation::ScopedOperation(const Operation op,
+                                 const std::uint64_t flops) noexcept {
+  if (current_operation != nullptr) return;
+
+  counters_ = &Counters().operations[static_cast<int>(op)];
+  current_operation = counters_;
+  Increment(counters_->calls, 1);
+  Increment(counters_->flops, flops);
+  start_ = std::chrono::steady_clock::now();
+}
+
+ScopedOperation::~ScopedOperation() {
+  if (counters_ == nullptr) return;
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start_);
+  const auto nanoseconds = static_cast<std::uint64_t>(elapsed.count());
+  Increment(counters_->nanoseconds, nanoseconds);
+  Increment(counters_->latency[LatencyBucket(nanoseconds)], 1);
+  current_operation = nullptr;
+}
+
+void RecordAllocation(const std::size_t bytes) noexcept {
+  OperationCounters* const counters = current_operation;
+  if (counters == nullptr) return;
+
+  Increment(counters->allocations, 1);
+  Increment(counters->bytes_allocated, bytes);
+}
+
+}  // namespace internal
+}  // namespace xMatrix
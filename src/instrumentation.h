@@ -0,0 +1,133 @@
+#ifndef XMATRIX_INSTRUMENTATION_H
+#define XMATRIX_INSTRUMENTATION_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+namespace xMatrix {
+
+// Opt-in accounting of the work done by the Matrix API. Configure with
+// -DXMATRIX_INSTRUMENTATION=ON (which defines XMATRIX_INSTRUMENTATION for
+// the library and everything linking it) and every public operation of
+// xmatrix.h records its calls, latency, nominal floating-point operations and
+// the matrix storage it allocates. Without the option the hooks expand to
+// nothing and the snapshot below stays all zeros.
+#if defined(XMATRIX_INSTRUMENTATION)
+constexpr bool kInstrumentationEnabled = true;
+#else
+constexpr bool kInstrumentationEnabled = false;
+#endif
+
+// Operators are booked under the method they stand for: operator* and *=
+// under kMulMatrix, += under kSumMatrix, == under kIsEqual. Accessors,
+// views and other O(1) members are not tracked.
+enum class Operation {
+  kConstruct,      // constructors taking a shape or a view
+  kCopy,           // copy construction and assignment
+  kMove,           // move construction and assignment
+  kEvaluate,       // evaluation of an element-wise expression (matrix_expr.h)
+  kResize,         // SetRows, SetCols and Resize
+  kIsEqual,
+  kSumMatrix,
+  kSubMatrix,
+  kMulNumber,
+  kMulMatrix,      // also the MulMatrix(view, view) free functions
+  kTranspose,
+  kTransposeInPlace,
+  kCalcComplements,
+  kDeterminant,    // Matrix and LUDecomposition
+  kInverseMatrix,  // InverseMatrix and LUDecomposition::Inverse
+  kLU,             // LU() and the LUDecomposition constructor
+  kLUFactors,      // GetL, GetU and GetP
+  kSolve,          // Solve and LUDecomposition::Solve
+  kReciprocalCondition,
+  kSolveMixedPrecision,
+  kPrintMatrix,
+  kSave,
+  kLoad,
+  kCount
+};
+
+constexpr int kOperationCount = static_cast<int>(Operation::kCount);
+
+// Latency histogram buckets: bucket 0 holds calls shorter than 1 ns, bucket
+// b calls of [2^(b-1), 2^b) ns, and the last one everything from about one
+// second up.
+constexpr int kLatencyBuckets = 32;
+
+struct OperationStats {
+  std::uint64_t calls;
+  std::uint64_t nanoseconds;  // wall time summed over the calls
+  std::uint64_t flops;        // nominal count, e.g. 2mnk for a product
+  std::uint64_t allocations;  // matrix buffers allocated, scratch included
+  std::uint64_t bytes_allocated;
+  std::array<std::uint64_t, kLatencyBuckets> latency;
+};
+
+struct InstrumentationSnapshot {
+  std::array<OperationStats, kOperationCount> operations;
+
+  [[nodiscard]] const OperationStats& operator[](Operation op) const {
+    return operations[static_cast<int>(op)];
+  }
+};
+
+// Totals over all threads, including threads that have exited, since the
+// last ResetInstrumentation(). Only calls made outside any other tracked call
+// are counted: the determinants inside CalcComplements() add to its time,
+// FLOPs and allocations, not to kDeterminant. Operations still running are
+// not included.
+[[nodiscard]] InstrumentationSnapshot GetInstrumentationSnapshot();
+void ResetInstrumentation();
+// Writes one line per operation that was called, with its counters and the
+// non-empty latency buckets.
+void DumpInstrumentation(std::ostream& out);
+[[nodiscard]] const char* GetOperationName(Operation op);
+
+namespace internal {
+
+// Counters of one thread. Only the owning thread writes them, with plain
+// loads and stores of relaxed atomics, so recording never takes a lock or a
+// locked instruction; snapshots read them concurrently.
+struct OperationCounters {
+  std::atomic<std::uint64_t> calls{0};
+  std::atomic<std::uint64_t> nanoseconds{0};
+  std::atomic<std::uint64_t> flops{0};
+  std::atomic<std::uint64_t> allocations{0};
+  std::atomic<std::uint64_t> bytes_allocated{0};
+  std::array<std::atomic<std::uint64_t>, kLatencyBuckets> latency{};
+};
+
+// Records one call of op on the calling thread from construction to
+// destruction, unless another tracked call is already running on it.
+class ScopedOperation {
+ public:
+  ScopedOperation(Operation op, std::uint64_t flops) noexcept;
+  ScopedOperation(const ScopedOperation&) = delete;
+  ScopedOperation& operator=(const ScopedOperation&) = delete;
+  ~ScopedOperation();
+
+ private:
+  OperationCounters* counters_ = nullptr;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Books bytes of matrix storage to the tracked call running on this thread.
+void RecordAllocation(std::size_t bytes) noexcept;
+
+}  // namespace internal
+}  // namespace xMatrix
+
+#if defined(XMATRIX_INSTRUMENTATION)
+#define XMATRIX_INSTRUMENT(op, flops)                                       \
+  const ::xMatrix::internal::ScopedOperation xmatrix_scoped_operation(      \
+      ::xMatrix::Operation::op, static_cast<std::uint64_t>(flops))
+#else
+#define XMATRIX_INSTRUMENT(op, flops) static_cast<void>(0)
+#endif
+
+#endif  // XMATRIX_INSTRUMENTATION_H
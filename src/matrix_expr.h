@@ -0,0 +1,346 @@
+#ifndef XMATRIX_MATRIX_EXPR_H
+#define XMATRIX_MATRIX_EXPR_H
+
+// Lazily evaluated element-wise expressions over Matrix. Included at the end
+// of xmatrix.h; do not include directly.
+//
+// A + B - C * 2.0 builds a small tree of expression objects and is evaluated
+// in one pass when it is assigned to a Matrix. Leaves refer to their matrices,
+// so an expression kept in an `auto` variable must not outlive its operands.
+// Expressions also offer the read-only Matrix methods, which evaluate them
+// first, so (A + B).Determinant() and (A * 2.0)(0, 0) work as they would on
+// a Matrix.
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "instrumentation.h"
+
+namespace xMatrix {
+
+namespace internal {
+
+struct PlusOp {
+  template <typename T>
+  static T Apply(const T& a, const T& b) {
+    return a + b;
+  }
+};
+
+struct MinusOp {
+  template <typename T>
+  static T Apply(const T& a, const T& b) {
+    return a - b;
+  }
+};
+
+}  // namespace internal
+
+// Base of the expression types: the const Matrix API, each call evaluating
+// the expression into a temporary BasicMatrix (element access reads the one
+// element instead).
+template <typename Derived, typename T>
+class MatrixExpr {
+ public:
+  [[nodiscard]] BasicMatrix<T> Eval() const { return BasicMatrix<T>(Self()); }
+
+  T operator()(const int r, const int c) const {
+    if (r >= Self().GetRows() || c >= Self().GetCols() || r < 0 || c < 0) {
+      throw std::invalid_argument("Incorrect index");
+    }
+
+    return Self()[static_cast<size_t>(r) * Self().GetCols() + c];
+  }
+
+  [[nodiscard]] bool IsEqual(const BasicMatrix<T>& other) const {
+    return Eval().IsEqual(other);
+  }
+  [[nodiscard]] BasicMatrix<T> Transpose() const { return Eval().Transpose(); }
+  [[nodiscard]] BasicMatrix<T> CalcComplements() const {
+    return Eval().CalcComplements();
+  }
+  [[nodiscard]] T Determinant() const { return Eval().Determinant(); }
+  [[nodiscard]] BasicMatrix<T> InverseMatrix() const {
+    return Eval().InverseMatrix();
+  }
+  [[nodiscard]] BasicLUDecomposition<T> LU() const { return Eval().LU(); }
+  void PrintMatrix() const { Eval().PrintMatrix(); }
+  void Save(const std::string& path) const { Eval().Save(path); }
+
+ private:
+  const Derived& Self() const { return static_cast<const Derived&>(*this); }
+};
+
+// Expression leaf referring to the elements of a BasicMatrix.
+template <typename T>
+class MatrixLeaf {
+ public:
+  using value_type = T;
+
+  explicit MatrixLeaf(const BasicMatrix<T>& m)
+      : data_(m.data()), rows_(m.GetRows()), cols_(m.GetCols()) {}
+
+  [[nodiscard]] int GetRows() const { return rows_; }
+  [[nodiscard]] int GetCols() const { return cols_; }
+  T operator[](const size_t i) const { return data_[i]; }
+
+ private:
+  const T* data_;
+  int rows_, cols_;
+};
+
+template <typename Op, typename L, typename R>
+class ElementwiseExpr
+    : public MatrixExpr<ElementwiseExpr<Op, L, R>, typename L::value_type> {
+ public:
+  using value_type = typename L::value_type;
+  static_assert(std::is_same_v<value_type, typename R::value_type>,
+                "Operands must have the same element type");
+
+  ElementwiseExpr(const L& l, const R& r) : l_(l), r_(r) {
+    if (l.GetRows() != r.GetRows() || l.GetCols() != r.GetCols()) {
+      throw std::invalid_argument("Matrices are not of the same size");
+    }
+  }
+
+  [[nodiscard]] int GetRows() const { return l_.GetRows(); }
+  [[nodiscard]] int GetCols() const { return l_.GetCols(); }
+  value_type operator[](const size_t i) const {
+    return Op::Apply(l_[i], r_[i]);
+  }
+
+ private:
+  L l_;
+  R r_;
+};
+
+template <typename E>
+class ScaledExpr : public MatrixExpr<ScaledExpr<E>, typename E::value_type> {
+ public:
+  using value_type = typename E::value_type;
+
+  ScaledExpr(const E& e, const value_type factor) : e_(e), factor_(factor) {}
+
+  [[nodiscard]] int GetRows() const { return e_.GetRows(); }
+  [[nodiscard]] int GetCols() const { return e_.GetCols(); }
+  value_type operator[](const size_t i) const { return e_[i] * factor_; }
+
+ private:
+  E e_;
+  value_type factor_;
+};
+
+namespace internal {
+
+template <typename Op, typename L, typename R>
+struct IsExpression<ElementwiseExpr<Op, L, R>> : std::true_type {};
+
+template <typename E>
+struct IsExpression<ScaledExpr<E>> : std::true_type {};
+
+template <typename T>
+struct IsMatrix : std::false_type {};
+
+template <typename T>
+struct IsMatrix<BasicMatrix<T>> : std::true_type {};
+
+template <typename T>
+constexpr bool kIsOperand = IsMatrix<T>::value || IsExpression<T>::value;
+
+template <typename L, typename R>
+using EnableIfOperands =
+    std::enable_if_t<kIsOperand<L> && kIsOperand<R>, int>;
+
+template <typename L, typename R>
+using EnableIfAnyExpression =
+    std::enable_if_t<kIsOperand<L> && kIsOperand<R> &&
+                         (IsExpression<L>::value || IsExpression<R>::value),
+                     int>;
+
+// Node type stored for an operand: matrices become leaves, expressions are
+// stored by value.
+template <typename T>
+struct Node {
+  using Type = T;
+};
+
+template <typename T>
+struct Node<BasicMatrix<T>> {
+  using Type = MatrixLeaf<T>;
+};
+
+template <typename T>
+using NodeType = typename Node<T>::Type;
+
+// Element type of an operand.
+template <typename T>
+using ValueType = typename T::value_type;
+
+template <typename T>
+const BasicMatrix<T>& Evaluate(const BasicMatrix<T>& m) {
+  return m;
+}
+
+template <typename E, typename = EnableIfExpression<E>>
+BasicMatrix<ValueType<E>> Evaluate(const E& e) {
+  return BasicMatrix<ValueType<E>>(e);
+}
+
+}  // namespace internal
+
+template <typename T>
+template <typename E, typename>
+BasicMatrix<T>::BasicMatrix(const E& expr)
+    : rows_(expr.GetRows()), cols_(expr.GetCols()) {
+  static_assert(std::is_same_v<internal::ValueType<E>, T>,
+                "Expression must have the element type of the matrix");
+  XMATRIX_INSTRUMENT(kEvaluate, 0);
+  matrix_ = MatrixType(static_cast<size_t>(rows_) * cols_);
+
+  T* out = matrix_.data();
+  const size_t size = matrix_.size();
+  for (size_t i = 0; i < size; i++) out[i] = expr[i];
+}
+
+template <typename T>
+template <typename E, typename>
+BasicMatrix<T>& BasicMatrix<T>::operator=(const E& expr) {
+  XMATRIX_INSTRUMENT(kEvaluate, 0);
+  if (expr.GetRows() != rows_ || expr.GetCols() != cols_) {
+    return *this = BasicMatrix(expr);
+  }
+
+  // Each element only depends on the same element of the operands, so
+  // evaluating straight into this buffer is safe even when it is one of them.
+  T* out = matrix_.data();
+  const size_t size = matrix_.size();
+  for (size_t i = 0; i < size; i++) out[i] = expr[i];
+
+  return *this;
+}
+
+template <typename T>
+template <typename E, typename>
+BasicMatrix<T>& BasicMatrix<T>::operator+=(const E& expr) {
+  XMATRIX_INSTRUMENT(kEvaluate, 0);
+  if (expr.GetRows() != rows_ || expr.GetCols() != cols_) {
+    throw std::invalid_argument("Matrices are not of the same size");
+  }
+
+  T* out = matrix_.data();
+  const size_t size = matrix_.size();
+  for (size_t i = 0; i < size; i++) out[i] += expr[i];
+
+  return *this;
+}
+
+template <typename T>
+template <typename E, typename>
+BasicMatrix<T>& BasicMatrix<T>::operator-=(const E& expr) {
+  XMATRIX_INSTRUMENT(kEvaluate, 0);
+  if (expr.GetRows() != rows_ || expr.GetCols() != cols_) {
+    throw std::invalid_argument("Matrices are not of the same size");
+  }
+
+  T* out = matrix_.data();
+  const size_t size = matrix_.size();
+  for (size_t i = 0; i < size; i++) out[i] -= expr[i];
+
+  return *this;
+}
+
+template <typename L, typename R, internal::EnableIfOperands<L, R> = 0>
+ElementwiseExpr<internal::PlusOp, internal::NodeType<L>, internal::NodeType<R>>
+operator+(const L& l, const R& r) {
+  return {internal::NodeType<L>(l), internal::NodeType<R>(r)};
+}
+
+template <typename L, typename R, internal::EnableIfOperands<L, R> = 0>
+ElementwiseExpr<internal::MinusOp, internal::NodeType<L>,
+                internal::NodeType<R>>
+operator-(const L& l, const R& r) {
+  return {internal::NodeType<L>(l), internal::NodeType<R>(r)};
+}
+
+template <typename E, internal::EnableIfOperands<E, E> = 0>
+ScaledExpr<internal::NodeType<E>> operator*(
+    const E& e, const internal::NoDeduce<internal::ValueType<E>> num) {
+  return {internal::NodeType<E>(e), num};
+}
+
+template <typename E, internal::EnableIfOperands<E, E> = 0>
+ScaledExpr<internal::NodeType<E>> operator*(
+    const internal::NoDeduce<internal::ValueType<E>> num, const E& e) {
+  return {internal::NodeType<E>(e), num};
+}
+
+// A temporary matrix operand already owns a buffer of the right size, so the
+// result is computed into it instead of a new allocation.
+template <typename T, typename R, internal::EnableIfOperands<R, R> = 0>
+BasicMatrix<T> operator+(BasicMatrix<T>&& l, const R& r) {
+  l += r;
+  return std::move(l);
+}
+
+template <typename T, typename L, internal::EnableIfOperands<L, L> = 0>
+BasicMatrix<T> operator+(const L& l, BasicMatrix<T>&& r) {
+  r += l;
+  return std::move(r);
+}
+
+template <typename T>
+BasicMatrix<T> operator+(BasicMatrix<T>&& l, BasicMatrix<T>&& r) {
+  l += r;
+  return std::move(l);
+}
+
+template <typename T, typename R, internal::EnableIfOperands<R, R> = 0>
+BasicMatrix<T> operator-(BasicMatrix<T>&& l, const R& r) {
+  l -= r;
+  return std::move(l);
+}
+
+template <typename T, typename L, internal::EnableIfOperands<L, L> = 0>
+BasicMatrix<T> operator-(const L& l, BasicMatrix<T>&& r) {
+  r = ElementwiseExpr<internal::MinusOp, internal::NodeType<L>, MatrixLeaf<T>>(
+      internal::NodeType<L>(l), MatrixLeaf<T>(r));
+  return std::move(r);
+}
+
+template <typename T>
+BasicMatrix<T> operator-(BasicMatrix<T>&& l, BasicMatrix<T>&& r) {
+  l -= r;
+  return std::move(l);
+}
+
+template <typename T>
+BasicMatrix<T> operator*(BasicMatrix<T>&& m, const internal::NoDeduce<T> num) {
+  m.MulNumber(num);
+  return std::move(m);
+}
+
+template <typename T>
+BasicMatrix<T> operator*(const internal::NoDeduce<T> num, BasicMatrix<T>&& m) {
+  m.MulNumber(num);
+  return std::move(m);
+}
+
+// Matrix products and comparisons need every element of their operands, so
+// expressions are evaluated first.
+template <typename L, typename R, internal::EnableIfAnyExpression<L, R> = 0>
+BasicMatrix<internal::ValueType<L>> operator*(const L& l, const R& r) {
+  BasicMatrix<internal::ValueType<L>> result = internal::Evaluate(l);
+  result.MulMatrix(internal::Evaluate(r));
+  return result;
+}
+
+template <typename L, typename R, internal::EnableIfAnyExpression<L, R> = 0>
+bool operator==(const L& l, const R& r) {
+  return internal::Evaluate(l).IsEqual(internal::Evaluate(r));
+}
+
+}  // namespace xMatrix
+#endif  // XMATRIX_MATRIX_EXPR_H
@@ -0,0 +1,293 @@
+#include "matrix_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <complex>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include "instrumentation.h"
+
+namespace xMatrix {
+
+namespace {
+
+constexpr char kMagic[8] = "XMATRIX";
+constexpr std::uint32_t kByteOrderMark = 0x01020304;
+
+template <typename T>
+constexpr MatrixFileType FileType() {
+  if constexpr (std::is_same_v<T, float>) {
+    return MatrixFileType::kFloat32;
+  } else if constexpr (std::is_same_v<T, double>) {
+    return MatrixFileType::kFloat64;
+  } else if constexpr (std::is_same_v<T, long double>) {
+    return MatrixFileType::kLongDouble;
+  } else if constexpr (std::is_same_v<T, std::complex<float>>) {
+    return MatrixFileType::kComplex64;
+  } else {
+    static_assert(std::is_same_v<T, std::complex<double>>);
+    return MatrixFileType::kComplex128;
+  }
+}
+
+std::system_error SystemError(const std::string& what,
+                              const std::string& path) {
+  return {errno, std::generic_category(), what + " " + path};
+}
+
+// Throws unless header describes a rows x cols matrix of T whose elements fit
+// in a file of file_size bytes.
+template <typename T>
+void CheckHeader(const MatrixFileHeader& header,
+                 const std::uint64_t file_size) {
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    throw std::invalid_argument("Not an xMatrix file");
+  }
+
+  if (header.version != kMatrixFileVersion) {
+    throw std::invalid_argument("Unsupported xMatrix file version");
+  }
+
+  if (header.byte_order != kByteOrderMark) {
+    throw std::invalid_argument("File was written with another byte order");
+  }
+
+  if (header.type != FileType<T>() || header.element_size != sizeof(T)) {
+    throw std::invalid_argument("File holds another element type");
+  }
+
+  if (header.layout != MatrixFileLayout::kRowMajor &&
+      header.layout != MatrixFileLayout::kColMajor) {
+    throw std::invalid_argument("Unknown element layout");
+  }
+
+  if (header.rows < 1 || header.cols < 1 || header.rows > INT_MAX ||
+      header.cols > INT_MAX) {
+    throw std::invalid_argument("Incorrect size");
+  }
+
+  // A mapped file hands out elements at data_offset, so it must suit T
+  // whatever alignment the header claims.
+  if (header.data_offset < sizeof(MatrixFileHeader) ||
+      header.alignment == 0 ||
+      (header.alignment & (header.alignment - 1)) != 0 ||
+      header.data_offset % header.alignment != 0 ||
+      header.data_offset % alignof(T) != 0 ||
+      header.data_offset > file_size ||
+      header.rows * header.cols >
+          (file_size - header.data_offset) / sizeof(T)) {
+    throw std::invalid_argument("File is truncated or corrupt");
+  }
+}
+
+}  // namespace
+
+namespace internal {
+
+template <typename T>
+MatrixFileHeader MakeFileHeader(const std::uint64_t rows,
+                                const std::uint64_t cols) {
+  MatrixFileHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kMatrixFileVersion;
+  header.byte_order = kByteOrderMark;
+  header.type = FileType<T>();
+  header.element_size = sizeof(T);
+  header.layout = MatrixFileLayout::kRowMajor;
+  header.alignment = kMatrixAlignment;
+  header.rows = rows;
+  header.cols = cols;
+  // The header is exactly one alignment unit long.
+  header.data_offset = kMatrixAlignment;
+
+  return header;
+}
+
+template <typename T>
+MatrixFileHeader ReadFileHeader(const int fd, const std::string& path) {
+  struct stat info {};
+  if (::fstat(fd, &info) != 0) throw SystemError("Cannot stat", path);
+
+  MatrixFileHeader header{};
+  const ssize_t n = ::pread(fd, &header, sizeof(header), 0);
+  if (n < 0) throw SystemError("Cannot read", path);
+  if (n != static_cast<ssize_t>(sizeof(header))) {
+    throw std::invalid_argument("Not an xMatrix file");
+  }
+
+  CheckHeader<T>(header, static_cast<std::uint64_t>(info.st_size));
+
+  return header;
+}
+
+}  // namespace internal
+
+// SAVE & LOAD
+template <typename T>
+void BasicMatrix<T>::Save(const std::string& path) const {
+  XMATRIX_INSTRUMENT(kSave, 0);
+  const MatrixFileHeader header = internal::MakeFileHeader<T>(rows_, cols_);
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) throw SystemError("Cannot create", path);
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(matrix_.data()),
+             static_cast<std::streamsize>(matrix_.size() * sizeof(T)));
+  file.close();
+  if (!file) throw SystemError("Cannot write", path);
+}
+
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::Load(const std::string& path) {
+  XMATRIX_INSTRUMENT(kLoad, 0);
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) throw SystemError("Cannot open", path);
+
+  const auto file_size = static_cast<std::uint64_t>(file.tellg());
+  MatrixFileHeader header{};
+  file.seekg(0);
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+    throw std::invalid_argument("Not an xMatrix file");
+  }
+  CheckHeader<T>(header, file_size);
+  // Unlike a mapped file, a Matrix indexes its elements with an int.
+  if (header.rows * header.cols > INT_MAX) {
+    throw std::invalid_argument("Incorrect size");
+  }
+
+  // A column-major file is the row-major transpose.
+  const bool col_major = header.layout == MatrixFileLayout::kColMajor;
+  const int rows = static_cast<int>(col_major ? header.cols : header.rows);
+  const int cols = static_cast<int>(col_major ? header.rows : header.cols);
+  BasicMatrix result(rows, cols);
+
+  file.seekg(static_cast<std::streamoff>(header.data_offset));
+  if (!file.read(reinterpret_cast<char*>(result.data()),
+                 static_cast<std::streamsize>(result.matrix_.size() *
+                                              sizeof(T)))) {
+    throw SystemError("Cannot read", path);
+  }
+
+  if (col_major) result.TransposeInPlace();
+
+  return result;
+}
+
+// MAPPED MATRIX
+template <typename T>
+BasicMappedMatrix<T>::BasicMappedMatrix(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) throw SystemError("Cannot open", path);
+
+  MatrixFileHeader header{};
+  struct stat info {};
+  try {
+    header = internal::ReadFileHeader<T>(fd, path);
+    if (::fstat(fd, &info) != 0) throw SystemError("Cannot stat", path);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+
+  // The mapping keeps the file referenced, so the descriptor can go now.
+  length_ = static_cast<std::size_t>(info.st_size);
+  mapping_ = ::mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+  const int map_errno = errno;
+  ::close(fd);
+  if (mapping_ == MAP_FAILED) {
+    mapping_ = nullptr;
+    length_ = 0;
+    errno = map_errno;
+    throw SystemError("Cannot map", path);
+  }
+
+  rows_ = static_cast<int>(header.rows);
+  cols_ = static_cast<int>(header.cols);
+  layout_ = header.layout;
+  data_offset_ = static_cast<std::size_t>(header.data_offset);
+}
+
+template <typename T>
+BasicMappedMatrix<T>::BasicMappedMatrix(BasicMappedMatrix&& o) noexcept
+    : mapping_(std::exchange(o.mapping_, nullptr)),
+      length_(std::exchange(o.length_, 0)),
+      rows_(o.rows_),
+      cols_(o.cols_),
+      layout_(o.layout_),
+      data_offset_(o.data_offset_) {}
+
+template <typename T>
+BasicMappedMatrix<T>& BasicMappedMatrix<T>::operator=(
+    BasicMappedMatrix&& o) noexcept {
+  if (this == &o) return *this;
+
+  Unmap();
+  mapping_ = std::exchange(o.mapping_, nullptr);
+  length_ = std::exchange(o.length_, 0);
+  rows_ = o.rows_;
+  cols_ = o.cols_;
+  layout_ = o.layout_;
+  data_offset_ = o.data_offset_;
+
+  return *this;
+}
+
+template <typename T>
+BasicMappedMatrix<T>::~BasicMappedMatrix() { Unmap(); }
+
+template <typename T>
+void BasicMappedMatrix<T>::Unmap() {
+  if (mapping_ != nullptr) ::munmap(mapping_, length_);
+  mapping_ = nullptr;
+  length_ = 0;
+}
+
+template <typename T>
+int BasicMappedMatrix<T>::GetRows() const { return rows_; }
+
+template <typename T>
+int BasicMappedMatrix<T>::GetCols() const { return cols_; }
+
+template <typename T>
+BasicMatrixView<const T> BasicMappedMatrix<T>::View() const {
+  if (mapping_ == nullptr) {
+    throw std::invalid_argument("The matrix has been moved from");
+  }
+
+  const T* data = reinterpret_cast<const T*>(
+      static_cast<const char*>(mapping_) + data_offset_);
+
+  if (layout_ == MatrixFileLayout::kColMajor) {
+    return {data, rows_, cols_, 1, rows_};
+  }
+  return {data, rows_, cols_, cols_};
+}
+
+template <typename T>
+BasicMappedMatrix<T>::operator BasicMatrixView<const T>() const {
+  return View();
+}
+
+// INSTANTIATIONS
+#define XMATRIX_INSTANTIATE_MATRIX_FILE(T)                                  \
+  template void BasicMatrix<T>::Save(const std::string& path) const;        \
+  template BasicMatrix<T> BasicMatrix<T>::Load(const std::string& path);    \
+  template class BasicMappedMatrix<T>;                                      \
+  template MatrixFileHeader internal::MakeFileHeader<T>(                    \
+      std::uint64_t rows, std::uint64_t cols);                              \
+  template MatrixFileHeader internal::ReadFileHeader<T>(                    \
+      int fd, const std::string& path);
+XMATRIX_FOR_EACH_SCALAR(XMATRIX_INSTANTIATE_MATRIX_FILE)
+#undef XMATRIX_INSTANTIATE_MATRIX_FILE
+
+}  // namespace xMatrix
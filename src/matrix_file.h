@@ -0,0 +1,98 @@
+#ifndef XMATRIX_MATRIX_FILE_H
+#define XMATRIX_MATRIX_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "xmatrix.h"
+
+namespace xMatrix {
+
+// Binary matrix files, written by Matrix::Save() and read by Matrix::Load()
+// and MappedMatrix. A file is a 64-byte MatrixFileHeader followed at
+// data_offset by rows * cols elements in host byte order, with no padding
+// between rows. data_offset is a multiple of the recorded alignment, a power
+// of two, and of alignof(T), so a mapped file hands out elements as aligned
+// as those of a Matrix.
+enum class MatrixFileType : std::uint32_t {
+  kFloat32 = 1,
+  kFloat64 = 2,
+  kLongDouble = 3,
+  kComplex64 = 4,
+  kComplex128 = 5,
+};
+
+enum class MatrixFileLayout : std::uint32_t { kRowMajor = 0, kColMajor = 1 };
+
+struct MatrixFileHeader {
+  char magic[8];  // "XMATRIX" and a terminating zero
+  std::uint32_t version;
+  // Written as 0x01020304; reads back differently on a host of the other
+  // byte order, which Load() rejects.
+  std::uint32_t byte_order;
+  MatrixFileType type;
+  std::uint32_t element_size;
+  MatrixFileLayout layout;
+  std::uint32_t alignment;
+  std::uint64_t rows;
+  std::uint64_t cols;
+  std::uint64_t data_offset;
+  std::uint8_t reserved[8];
+};
+
+static_assert(sizeof(MatrixFileHeader) == 64, "header layout changed");
+
+constexpr std::uint32_t kMatrixFileVersion = 1;
+
+// Read-only matrix backed by a memory-mapped file. Opening costs the same for
+// any file size: elements are paged in by the OS as they are touched and
+// dropped again under memory pressure. View() plugs into every function that
+// takes a view, e.g. MulMatrix(mapped.View(), x) or Matrix(mapped.View()).
+// Throws std::invalid_argument when the file is not a matrix of T and
+// std::system_error when it cannot be opened or mapped.
+template <typename T>
+class BasicMappedMatrix {
+ public:
+  explicit BasicMappedMatrix(const std::string& path);
+  BasicMappedMatrix(const BasicMappedMatrix&) = delete;
+  BasicMappedMatrix& operator=(const BasicMappedMatrix&) = delete;
+  BasicMappedMatrix(BasicMappedMatrix&& o) noexcept;
+  BasicMappedMatrix& operator=(BasicMappedMatrix&& o) noexcept;
+  ~BasicMappedMatrix();
+
+  [[nodiscard]] int GetRows() const;
+  [[nodiscard]] int GetCols() const;
+  // Stays valid while this object is alive. Column-major files come back as
+  // a transposed view, so element (r, c) is the same either way.
+  [[nodiscard]] BasicMatrixView<const T> View() const;
+  operator BasicMatrixView<const T>() const;  // NOLINT
+
+ private:
+  void Unmap();
+
+  void* mapping_ = nullptr;
+  std::size_t length_ = 0;
+  int rows_ = 0, cols_ = 0;
+  MatrixFileLayout layout_ = MatrixFileLayout::kRowMajor;
+  std::size_t data_offset_ = 0;
+};
+
+using MappedMatrix = BasicMappedMatrix<double>;
+
+namespace internal {
+
+// Header Save() writes for a rows x cols matrix of T; the elements follow at
+// data_offset in row-major order.
+template <typename T>
+MatrixFileHeader MakeFileHeader(std::uint64_t rows, std::uint64_t cols);
+
+// Reads the header of the open file fd and checks that the file holds a
+// complete matrix of T; path only goes into error messages.
+template <typename T>
+MatrixFileHeader ReadFileHeader(int fd, const std::string& path);
+
+}  // namespace internal
+
+}  // namespace xMatrix
+#endif  // XMATRIX_MATRIX_FILE_H
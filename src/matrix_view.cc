@@ -0,0 +1,194 @@
+#include "matrix_view.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "gemm.h"
+#include "simd.h"
+
+namespace xMatrix {
+
+namespace {
+
+template <typename T>
+void CheckSameSize(const BasicMatrixView<const T>& a,
+                   const BasicMatrixView<const T>& b) {
+  if (a.GetRows() != b.GetRows() || a.GetCols() != b.GetCols()) {
+    throw std::invalid_argument("Matrices are not of the same size");
+  }
+}
+
+// Runs row_kernel(dst_row, src_row, count) over unit-stride rows, or over the
+// whole buffer when both views are contiguous, and element(dst, src) on
+// anything strided.
+template <typename T, typename RowKernel, typename Element>
+void Elementwise(const BasicMatrixView<T>& dst,
+                 const BasicMatrixView<const T>& src, RowKernel row_kernel,
+                 Element element) {
+  CheckSameSize<T>(dst, src);
+
+  const int rows = dst.GetRows(), cols = dst.GetCols();
+
+  if (dst.IsContiguous() && src.IsContiguous()) {
+    row_kernel(dst.data(), src.data(), static_cast<size_t>(rows) * cols);
+    return;
+  }
+
+  for (int i = 0; i < rows; i++) {
+    T* d = dst.data() + i * dst.GetRowStride();
+    const T* s = src.data() + i * src.GetRowStride();
+
+    if (dst.GetColStride() == 1 && src.GetColStride() == 1) {
+      row_kernel(d, s, cols);
+    } else {
+      for (int j = 0; j < cols; j++)
+        element(d[j * dst.GetColStride()], s[j * src.GetColStride()]);
+    }
+  }
+}
+
+template <typename T>
+void CopyMatrixImpl(const BasicMatrixView<const T> src,
+                    const BasicMatrixView<T> dst) {
+  // Copying between a transposed and a plain layout is a transpose of the
+  // underlying rows; hand it to the blocked kernel instead of scattering.
+  if (src.GetRowStride() == 1 && src.GetColStride() != 1 &&
+      dst.GetColStride() == 1) {
+    CheckSameSize<T>(dst, src);
+    internal::Transpose(src.data(), src.GetColStride(), dst.data(),
+                        dst.GetRowStride(), src.GetCols(), src.GetRows());
+    return;
+  }
+  if (dst.GetRowStride() == 1 && dst.GetColStride() != 1 &&
+      src.GetColStride() == 1) {
+    CheckSameSize<T>(dst, src);
+    internal::Transpose(src.data(), src.GetRowStride(), dst.data(),
+                        dst.GetColStride(), src.GetRows(), src.GetCols());
+    return;
+  }
+
+  Elementwise(
+      dst, src,
+      [](T* d, const T* s, const size_t n) {
+        if (d != s) std::copy_n(s, n, d);
+      },
+      [](T& d, const T& s) { d = s; });
+}
+
+template <typename T>
+void SumMatrixImpl(const BasicMatrixView<T> dst,
+                   const BasicMatrixView<const T> src) {
+  Elementwise(
+      dst, src,
+      [](T* d, const T* s, const size_t n) { internal::Add(d, s, n); },
+      [](T& d, const T& s) { d += s; });
+}
+
+template <typename T>
+void SubMatrixImpl(const BasicMatrixView<T> dst,
+                   const BasicMatrixView<const T> src) {
+  Elementwise(
+      dst, src,
+      [](T* d, const T* s, const size_t n) { internal::Sub(d, s, n); },
+      [](T& d, const T& s) { d -= s; });
+}
+
+template <typename T>
+void MulNumberImpl(const BasicMatrixView<T> dst, const T num) {
+  if (dst.IsContiguous()) {
+    internal::Scale(dst.data(), num,
+                    static_cast<size_t>(dst.GetRows()) * dst.GetCols());
+    return;
+  }
+
+  for (int i = 0; i < dst.GetRows(); i++) {
+    T* d = dst.data() + i * dst.GetRowStride();
+
+    if (dst.GetColStride() == 1) {
+      internal::Scale(d, num, dst.GetCols());
+    } else {
+      for (int j = 0; j < dst.GetCols(); j++) d[j * dst.GetColStride()] *= num;
+    }
+  }
+}
+
+template <typename T>
+void MulMatrixImpl(const BasicMatrixView<const T> a,
+                   const BasicMatrixView<const T> b,
+                   const BasicMatrixView<T> dst) {
+  if (a.GetCols() != b.GetRows()) {
+    throw std::invalid_argument(
+        "Num of cols in the first matrix must be equal the num of rows in the "
+        "second matrix");
+  }
+
+  if (dst.GetRows() != a.GetRows() || dst.GetCols() != b.GetCols()) {
+    throw std::invalid_argument("Matrices are not of the same size");
+  }
+
+  for (int i = 0; i < dst.GetRows(); i++)
+    for (int j = 0; j < dst.GetCols(); j++)
+      dst.data()[i * dst.GetRowStride() + j * dst.GetColStride()] = T();
+
+  internal::Gemm(a, b, dst);
+}
+
+template <typename T>
+bool IsEqualImpl(const BasicMatrixView<const T> a,
+                 const BasicMatrixView<const T> b) {
+  if (a.GetRows() != b.GetRows() || a.GetCols() != b.GetCols()) return false;
+
+  if (a.IsContiguous() && b.IsContiguous()) {
+    return internal::EqualWithin(
+        a.data(), b.data(), static_cast<size_t>(a.GetRows()) * a.GetCols(),
+        kEpsilon<T>);
+  }
+
+  for (int i = 0; i < a.GetRows(); i++) {
+    const T* x = a.data() + i * a.GetRowStride();
+    const T* y = b.data() + i * b.GetRowStride();
+
+    if (a.GetColStride() == 1 && b.GetColStride() == 1) {
+      if (!internal::EqualWithin(x, y, a.GetCols(), kEpsilon<T>)) return false;
+    } else {
+      for (int j = 0; j < a.GetCols(); j++)
+        if (std::abs(x[j * a.GetColStride()] - y[j * b.GetColStride()]) >=
+            kEpsilon<T>)
+          return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace
+
+#define XMATRIX_DEFINE_VIEW_KERNELS(T)                                      \
+  void CopyMatrix(const BasicMatrixView<const T> src,                       \
+                  const BasicMatrixView<T> dst) {                           \
+    CopyMatrixImpl(src, dst);                                               \
+  }                                                                         \
+  void SumMatrix(const BasicMatrixView<T> dst,                              \
+                 const BasicMatrixView<const T> src) {                      \
+    SumMatrixImpl(dst, src);                                                \
+  }                                                                         \
+  void SubMatrix(const BasicMatrixView<T> dst,                              \
+                 const BasicMatrixView<const T> src) {                      \
+    SubMatrixImpl(dst, src);                                                \
+  }                                                                         \
+  void MulNumber(const BasicMatrixView<T> dst, const T num) {               \
+    MulNumberImpl(dst, num);                                                \
+  }                                                                         \
+  void MulMatrix(const BasicMatrixView<const T> a,                          \
+                 const BasicMatrixView<const T> b,                          \
+                 const BasicMatrixView<T> dst) {                            \
+    MulMatrixImpl(a, b, dst);                                               \
+  }                                                                         \
+  bool IsEqual(const BasicMatrixView<const T> a,                            \
+               const BasicMatrixView<const T> b) {                          \
+    return IsEqualImpl(a, b);                                               \
+  }
+XMATRIX_FOR_EACH_SCALAR(XMATRIX_DEFINE_VIEW_KERNELS)
+#undef XMATRIX_DEFINE_VIEW_KERNELS
+
+}  // namespace xMatrix
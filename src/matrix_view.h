@@ -0,0 +1,114 @@
+#ifndef XMATRIX_MATRIX_VIEW_H
+#define XMATRIX_MATRIX_VIEW_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+#include "scalar_traits.h"
+
+namespace xMatrix {
+
+// Non-owning window onto matrix elements: element (r, c) lives at
+// data[r * row_stride + c * col_stride]. Blocks, rows and columns of a Matrix
+// are views, so slicing never copies. A view must not outlive the storage it
+// refers to.
+template <typename T>
+class BasicMatrixView {
+ public:
+  BasicMatrixView(T* data, const int rows, const int cols,
+                  const std::ptrdiff_t row_stride,
+                  const std::ptrdiff_t col_stride = 1)
+      : data_(data),
+        rows_(rows),
+        cols_(cols),
+        row_stride_(row_stride),
+        col_stride_(col_stride) {
+    if (rows < 1 || cols < 1) {
+      throw std::invalid_argument(
+          "Input arguments must be positive and not equal to zero");
+    }
+  }
+
+  // A mutable view converts to a read-only one.
+  template <typename U,
+            typename = std::enable_if_t<std::is_same_v<const U, T> &&
+                                        !std::is_same_v<U, T>>>
+  BasicMatrixView(const BasicMatrixView<U>& o)  // NOLINT
+      : BasicMatrixView(o.data(), o.GetRows(), o.GetCols(), o.GetRowStride(),
+                        o.GetColStride()) {}
+
+  [[nodiscard]] int GetRows() const { return rows_; }
+  [[nodiscard]] int GetCols() const { return cols_; }
+  [[nodiscard]] std::ptrdiff_t GetRowStride() const { return row_stride_; }
+  [[nodiscard]] std::ptrdiff_t GetColStride() const { return col_stride_; }
+  [[nodiscard]] T* data() const { return data_; }
+
+  T& operator()(const int r, const int c) const {
+    if (r >= rows_ || c >= cols_ || r < 0 || c < 0) {
+      throw std::invalid_argument("Incorrect index");
+    }
+
+    return data_[r * row_stride_ + c * col_stride_];
+  }
+
+  [[nodiscard]] BasicMatrixView Block(const int r, const int c, const int h,
+                                      const int w) const {
+    if (r < 0 || c < 0 || h < 1 || w < 1 || r + h > rows_ || c + w > cols_) {
+      throw std::invalid_argument("Incorrect index");
+    }
+
+    return {data_ + r * row_stride_ + c * col_stride_, h, w, row_stride_,
+            col_stride_};
+  }
+
+  [[nodiscard]] BasicMatrixView Row(const int i) const {
+    return Block(i, 0, 1, cols_);
+  }
+
+  [[nodiscard]] BasicMatrixView Col(const int j) const {
+    return Block(0, j, rows_, 1);
+  }
+
+  // The transpose as a view of the same elements: swaps the shape and the
+  // strides, so it costs nothing and writes go through to the original.
+  [[nodiscard]] BasicMatrixView Transpose() const {
+    return {data_, cols_, rows_, col_stride_, row_stride_};
+  }
+
+  // True when the rows are packed back to back, as in a Matrix.
+  [[nodiscard]] bool IsContiguous() const {
+    return col_stride_ == 1 && (rows_ == 1 || row_stride_ == cols_);
+  }
+
+ private:
+  T* data_;
+  int rows_, cols_;
+  std::ptrdiff_t row_stride_, col_stride_;
+};
+
+using MatrixView = BasicMatrixView<double>;
+using ConstMatrixView = BasicMatrixView<const double>;
+
+// View kernels, mirroring the Matrix members of the same names, for every
+// element type in XMATRIX_FOR_EACH_SCALAR. They are plain overloads rather
+// than templates so that a BasicMatrix converts to a view at the call site.
+// The destination must not overlap a source other than being the same view.
+//
+// MulMatrix computes dst = a * b; dst must not overlap a or b. Either operand
+// may be a transposed view, e.g. MulMatrix(a.TransposeView(), b, dst)
+// computes A^T * B without materialising A^T.
+#define XMATRIX_DECLARE_VIEW_KERNELS(T)                                      \
+  void CopyMatrix(BasicMatrixView<const T> src, BasicMatrixView<T> dst);     \
+  void SumMatrix(BasicMatrixView<T> dst, BasicMatrixView<const T> src);      \
+  void SubMatrix(BasicMatrixView<T> dst, BasicMatrixView<const T> src);      \
+  void MulNumber(BasicMatrixView<T> dst, T num);                             \
+  void MulMatrix(BasicMatrixView<const T> a, BasicMatrixView<const T> b,     \
+                 BasicMatrixView<T> dst);                                    \
+  [[nodiscard]] bool IsEqual(BasicMatrixView<const T> a,                     \
+                             BasicMatrixView<const T> b);
+XMATRIX_FOR_EACH_SCALAR(XMATRIX_DECLARE_VIEW_KERNELS)
+#undef XMATRIX_DECLARE_VIEW_KERNELS
+
+}  // namespace xMatrix
+#endif  // XMATRIX_MATRIX_VIEW_H
@@ -0,0 +1,289 @@
+#include "out_of_core.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gemm.h"
+#include "matrix_file.h"
+
+namespace xMatrix {
+
+namespace {
+
+std::system_error SystemError(const std::string& what,
+                              const std::string& path) {
+  return {errno, std::generic_category(), what + " " + path};
+}
+
+// Owns a file descriptor for the duration of a product.
+class File {
+ public:
+  File(const std::string& path, const int flags)
+      : path_(path), fd_(::open(path.c_str(), flags | O_CLOEXEC, 0644)) {
+    if (fd_ < 0) throw SystemError("Cannot open", path);
+  }
+  File(const File&) = delete;
+  File& operator=(const File&) = delete;
+  ~File() { ::close(fd_); }
+
+  [[nodiscard]] int GetFd() const { return fd_; }
+
+  // Whether path names this file, through any link.
+  [[nodiscard]] bool IsSameFile(const std::string& path) const {
+    struct stat other {};
+    if (::stat(path.c_str(), &other) != 0) return false;
+    struct stat own {};
+    if (::fstat(fd_, &own) != 0) throw SystemError("Cannot stat", path_);
+    return own.st_dev == other.st_dev && own.st_ino == other.st_ino;
+  }
+
+  void ReadAt(void* data, std::size_t size, std::uint64_t offset) const {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+      const ssize_t n = ::pread(fd_, p, size, static_cast<off_t>(offset));
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) throw SystemError("Cannot read", path_);
+      if (n == 0) throw std::invalid_argument("File is truncated or corrupt");
+      p += n;
+      size -= static_cast<std::size_t>(n);
+      offset += static_cast<std::uint64_t>(n);
+    }
+  }
+
+  void WriteAt(const void* data, std::size_t size,
+               std::uint64_t offset) const {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+      const ssize_t n = ::pwrite(fd_, p, size, static_cast<off_t>(offset));
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) throw SystemError("Cannot write", path_);
+      p += n;
+      size -= static_cast<std::size_t>(n);
+      offset += static_cast<std::uint64_t>(n);
+    }
+  }
+
+ private:
+  std::string path_;
+  int fd_;
+};
+
+// A matrix file read one tile at a time.
+template <typename T>
+class TiledFile {
+ public:
+  explicit TiledFile(const std::string& path)
+      : file_(path, O_RDONLY),
+        header_(internal::ReadFileHeader<T>(file_.GetFd(), path)) {}
+
+  [[nodiscard]] int GetRows() const { return static_cast<int>(header_.rows); }
+  [[nodiscard]] int GetCols() const { return static_cast<int>(header_.cols); }
+  [[nodiscard]] const File& GetFile() const { return file_; }
+
+  // Reads the h x w block at (r, c) into tile in the layout of the file, one
+  // pread per stored row or column, and returns a view of it.
+  BasicMatrixView<const T> ReadTile(const int r, const int c, const int h,
+                                    const int w, T* tile) const {
+    const std::uint64_t rows = header_.rows, cols = header_.cols;
+
+    if (header_.layout == MatrixFileLayout::kColMajor) {
+      for (int j = 0; j < w; j++)
+        file_.ReadAt(tile + static_cast<std::size_t>(j) * h, h * sizeof(T),
+                     header_.data_offset + ((c + j) * rows + r) * sizeof(T));
+      return {tile, h, w, 1, h};
+    }
+
+    for (int i = 0; i < h; i++)
+      file_.ReadAt(tile + static_cast<std::size_t>(i) * w, w * sizeof(T),
+                   header_.data_offset + ((r + i) * cols + c) * sizeof(T));
+    return {tile, h, w, w};
+  }
+
+ private:
+  File file_;
+  MatrixFileHeader header_;
+};
+
+// Runs load(step) for steps 0, 1, ... on one background thread, at most one
+// step ahead of the consumer, so that the two tile slots alternate: step s
+// fills slot s % 2 once the consumer has moved on from step s - 2.
+class Prefetcher {
+ public:
+  Prefetcher(const long steps, std::function<void(long)> load)
+      : steps_(steps), load_(std::move(load)), thread_([this] { Run(); }) {}
+  Prefetcher(const Prefetcher&) = delete;
+  Prefetcher& operator=(const Prefetcher&) = delete;
+  ~Prefetcher() {
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+  }
+
+  // Waits until step is loaded, releasing the slot of step - 1, and rethrows
+  // whatever a load threw.
+  void Acquire(const long step) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    acquired_ = step;
+    changed_.notify_all();
+    changed_.wait(lock, [&] { return loaded_ > step || error_; });
+    if (error_) std::rethrow_exception(error_);
+  }
+
+ private:
+  void Run() {
+    for (long step = 0; step < steps_; step++) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&] {
+          return stop_ || step < 2 || acquired_ >= step - 1;
+        });
+        if (stop_) return;
+      }
+      try {
+        load_(step);
+      } catch (...) {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        error_ = std::current_exception();
+        changed_.notify_all();
+        return;
+      }
+      {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        loaded_ = step + 1;
+      }
+      changed_.notify_all();
+    }
+  }
+
+  const long steps_;
+  const std::function<void(long)> load_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  long acquired_ = -1;
+  long loaded_ = 0;
+  bool stop_ = false;
+  std::exception_ptr error_;
+  std::thread thread_;  // last, so it starts once the rest is constructed
+};
+
+}  // namespace
+
+template <typename T>
+void MulMatrixFiles(const std::string& a_path, const std::string& b_path,
+                    const std::string& c_path,
+                    const OutOfCoreOptions& options) {
+  const TiledFile<T> a(a_path), b(b_path);
+
+  if (a.GetCols() != b.GetRows()) {
+    throw std::invalid_argument(
+        "Num of cols in the first matrix must be equal the num of rows in the "
+        "second matrix");
+  }
+
+  // C is truncated below, which would destroy an input it aliases.
+  if (a.GetFile().IsSameFile(c_path) || b.GetFile().IsSameFile(c_path)) {
+    throw std::invalid_argument("Output file must differ from the inputs");
+  }
+
+  const int m = a.GetRows(), k = a.GetCols(), n = b.GetCols();
+
+  // Square C tiles as large as the budget allows with square A and B tiles,
+  // then whatever is left goes into the depth of the A and B tiles: fewer,
+  // larger multiplies per C tile. tm * tn + 2 * tk * (tm + tn) elements.
+  const std::size_t budget = options.memory_budget / sizeof(T);
+  const auto edge = static_cast<std::size_t>(std::sqrt(budget / 5.0));
+  if (edge < 1) {
+    throw std::invalid_argument("Memory budget is too small");
+  }
+  const int tm = static_cast<int>(std::min<std::size_t>(m, edge));
+  const int tn = static_cast<int>(std::min<std::size_t>(n, edge));
+  const int tk = static_cast<int>(std::min<std::size_t>(
+      k, (budget - static_cast<std::size_t>(tm) * tn) / (2 * (tm + tn))));
+
+  const long row_tiles = (m + tm - 1) / tm;
+  const long col_tiles = (n + tn - 1) / tn;
+  const long inner_tiles = (k + tk - 1) / tk;
+  const long steps = row_tiles * col_tiles * inner_tiles;
+
+  const File c(c_path, O_RDWR | O_CREAT | O_TRUNC);
+  const MatrixFileHeader header = internal::MakeFileHeader<T>(m, n);
+  c.WriteAt(&header, sizeof(header), 0);
+  const std::uint64_t c_size =
+      header.data_offset + static_cast<std::uint64_t>(m) * n * sizeof(T);
+  if (::ftruncate(c.GetFd(), static_cast<off_t>(c_size)) != 0) {
+    throw SystemError("Cannot write", c_path);
+  }
+
+  std::vector<T> a_tiles[2], b_tiles[2];
+  for (int slot = 0; slot < 2; slot++) {
+    a_tiles[slot].resize(static_cast<std::size_t>(tm) * tk);
+    b_tiles[slot].resize(static_cast<std::size_t>(tk) * tn);
+  }
+  std::vector<T> c_tile(static_cast<std::size_t>(tm) * tn);
+
+  // Step s multiplies inner tile s % inner_tiles into C tile s / inner_tiles,
+  // so the inner tiles of one C tile are consecutive.
+  using Tiles = std::pair<BasicMatrixView<const T>, BasicMatrixView<const T>>;
+  std::optional<Tiles> slots[2];
+  Prefetcher prefetcher(steps, [&](const long step) {
+    const int slot = static_cast<int>(step % 2);
+    const long tile = step / inner_tiles;
+    const int r = static_cast<int>(tile / col_tiles) * tm;
+    const int col = static_cast<int>(tile % col_tiles) * tn;
+    const int p = static_cast<int>(step % inner_tiles) * tk;
+    const int h = std::min(tm, m - r), w = std::min(tn, n - col);
+    const int d = std::min(tk, k - p);
+    slots[slot].emplace(a.ReadTile(r, p, h, d, a_tiles[slot].data()),
+                        b.ReadTile(p, col, d, w, b_tiles[slot].data()));
+  });
+
+  for (long step = 0; step < steps; step++) {
+    // The prefetcher reads the following pair into the other slot while this
+    // one is multiplied.
+    prefetcher.Acquire(step);
+    const Tiles& tiles = *slots[step % 2];
+
+    const int h = tiles.first.GetRows(), w = tiles.second.GetCols();
+    const BasicMatrixView<T> c_view(c_tile.data(), h, w, w);
+    if (step % inner_tiles == 0) std::fill(c_tile.begin(), c_tile.end(), T());
+    internal::Gemm<T>(tiles.first, tiles.second, c_view);
+
+    if (step % inner_tiles == inner_tiles - 1) {
+      const long tile = step / inner_tiles;
+      const std::uint64_t r = tile / col_tiles * tm;
+      const std::uint64_t col = tile % col_tiles * tn;
+      for (int i = 0; i < h; i++)
+        c.WriteAt(c_tile.data() + static_cast<std::size_t>(i) * w,
+                  w * sizeof(T),
+                  header.data_offset + ((r + i) * n + col) * sizeof(T));
+    }
+  }
+}
+
+#define XMATRIX_INSTANTIATE_MUL_MATRIX_FILES(T)                             \
+  template void MulMatrixFiles<T>(                                          \
+      const std::string& a_path, const std::string& b_path,                 \
+      const std::string& c_path, const OutOfCoreOptions& options);
+XMATRIX_FOR_EACH_SCALAR(XMATRIX_INSTANTIATE_MUL_MATRIX_FILES)
+#undef XMATRIX_INSTANTIATE_MUL_MATRIX_FILES
+
+}  // namespace xMatrix
@@ -0,0 +1,36 @@
+#ifndef XMATRIX_OUT_OF_CORE_H
+#define XMATRIX_OUT_OF_CORE_H
+
+#include <cstddef>
+#include <string>
+
+namespace xMatrix {
+
+struct OutOfCoreOptions {
+  // Bytes of tile buffers held at once: the C tile being accumulated plus two
+  // tiles each of A and B, one being multiplied while the other is read.
+  std::size_t memory_budget = std::size_t{1} << 30;
+};
+
+// Computes C = A * B for operands stored in matrix files (matrix_file.h) that
+// need not fit in memory, and writes C to c_path as a row-major matrix file.
+// C is produced tile by tile; for every tile the matching tiles of A and B
+// are streamed in, the next pair being read on a background thread while the
+// current one is multiplied. A and B may be row- or column-major.
+//
+// options.memory_budget bounds the tile buffers, so memory use does not grow
+// with the matrix sizes. The in-memory product of each tile pair adds its
+// packing buffers on top: they are sized to the CPU caches (a few MB per
+// thread) and kept in the scratch pool between calls (scratch_pool.h).
+//
+// Instantiated for the types in XMATRIX_FOR_EACH_SCALAR. Throws
+// std::invalid_argument for incompatible files, for a c_path naming one of
+// the inputs, or for a budget too small for one element per tile, and
+// std::system_error when file I/O fails.
+template <typename T = double>
+void MulMatrixFiles(const std::string& a_path, const std::string& b_path,
+                    const std::string& c_path,
+                    const OutOfCoreOptions& options = {});
+
+}  // namespace xMatrix
+#endif  // XMATRIX_OUT_OF_CORE_H
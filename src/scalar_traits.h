@@ -0,0 +1,82 @@
+#ifndef XMATRIX_SCALAR_TRAITS_H
+#define XMATRIX_SCALAR_TRAITS_H
+
+#include <cmath>
+#include <complex>
+#include <type_traits>
+
+// Element types BasicMatrix and the kernels behind it are instantiated for.
+#define XMATRIX_FOR_EACH_SCALAR(X) \
+  X(float)                         \
+  X(double)                        \
+  X(long double)                   \
+  X(std::complex<float>)           \
+  X(std::complex<double>)
+
+namespace xMatrix {
+
+constexpr double EPS = 1e-8;
+
+namespace internal {
+
+template <typename T>
+struct ScalarTraits {
+  using Real = T;
+  static constexpr bool kIsComplex = false;
+};
+
+template <typename T>
+struct ScalarTraits<std::complex<T>> {
+  using Real = T;
+  static constexpr bool kIsComplex = true;
+};
+
+// Type of |x| for an element x: the element type itself, or the type of the
+// parts of a complex number.
+template <typename T>
+using RealType = typename ScalarTraits<T>::Real;
+
+template <typename T>
+constexpr bool kIsComplex = ScalarTraits<T>::kIsComplex;
+
+// Keeps a parameter out of template argument deduction, so m * 2.0 works for
+// a float matrix.
+template <typename T>
+struct TypeIdentity {
+  using Type = T;
+};
+
+template <typename T>
+using NoDeduce = typename TypeIdentity<T>::Type;
+
+template <typename T>
+T Conj(const T& x) {
+  if constexpr (kIsComplex<T>) {
+    return std::conj(x);
+  } else {
+    return x;
+  }
+}
+
+template <typename R>
+constexpr R RealEpsilon() {
+  if constexpr (std::is_same_v<R, float>) {
+    return 1e-5F;
+  } else if constexpr (std::is_same_v<R, long double>) {
+    return 1e-10L;
+  } else {
+    return static_cast<R>(EPS);
+  }
+}
+
+}  // namespace internal
+
+// Tolerance IsEqual uses for elements of type T: EPS for double, looser for
+// float and tighter for long double; complex types use the tolerance of their
+// parts on |a - b|.
+template <typename T>
+constexpr internal::RealType<T> kEpsilon =
+    internal::RealEpsilon<internal::RealType<T>>();
+
+}  // namespace xMatrix
+#endif  // XMATRIX_SCALAR_TRAITS_H
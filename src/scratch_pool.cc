@@ -0,0 +1,111 @@
+#include "scratch_pool.h"
+
+#include <vector>
+
+namespace xMatrix {
+namespace internal {
+
+namespace {
+
+// Buffers are pooled in power-of-two size classes from 64 bytes upwards, so
+// a recycled buffer is never more than twice the size requested.
+constexpr int kMinClassShift = 6;
+constexpr int kClassCount = 40;
+
+class ScratchPool : public std::pmr::memory_resource {
+ public:
+  ScratchPool() = default;
+  ScratchPool(const ScratchPool&) = delete;
+  ScratchPool& operator=(const ScratchPool&) = delete;
+  ~ScratchPool() override { Release(); }
+
+  [[nodiscard]] ScratchStats GetStats() const { return stats_; }
+
+  void Release() {
+    for (int c = 0; c < kClassCount; c++) {
+      for (void* p : free_[c])
+        upstream_->deallocate(p, ClassBytes(c), kClassAlignment);
+      free_[c].clear();
+      free_[c].shrink_to_fit();
+    }
+    stats_ = {};
+  }
+
+ private:
+  // Every class is allocated with the same alignment, so a buffer serves any
+  // request of its class whatever alignment that request asks for.
+  static constexpr std::size_t kClassAlignment = 64;
+
+  static int SizeClass(const std::size_t bytes) {
+    int c = 0;
+    while ((std::size_t{1} << (c + kMinClassShift)) < bytes) c++;
+    return c;
+  }
+
+  static std::size_t ClassBytes(const int c) {
+    return std::size_t{1} << (c + kMinClassShift);
+  }
+
+  void* do_allocate(const std::size_t bytes,
+                    const std::size_t alignment) override {
+    const int c = SizeClass(bytes);
+    if (c >= kClassCount || alignment > kClassAlignment) {
+      stats_.misses++;
+      return upstream_->allocate(bytes, alignment);
+    }
+
+    if (!free_[c].empty()) {
+      void* p = free_[c].back();
+      free_[c].pop_back();
+      stats_.hits++;
+      stats_.bytes_cached -= ClassBytes(c);
+      return p;
+    }
+
+    stats_.misses++;
+    return upstream_->allocate(ClassBytes(c), kClassAlignment);
+  }
+
+  void do_deallocate(void* p, const std::size_t bytes,
+                     const std::size_t alignment) override {
+    const int c = SizeClass(bytes);
+    if (c >= kClassCount || alignment > kClassAlignment) {
+      upstream_->deallocate(p, bytes, alignment);
+      return;
+    }
+
+    if (stats_.bytes_cached + ClassBytes(c) > kScratchCacheLimit) {
+      upstream_->deallocate(p, ClassBytes(c), kClassAlignment);
+      return;
+    }
+
+    free_[c].push_back(p);
+    stats_.bytes_cached += ClassBytes(c);
+  }
+
+  [[nodiscard]] bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource* upstream_ = std::pmr::new_delete_resource();
+  std::vector<void*> free_[kClassCount];
+  ScratchStats stats_{};
+};
+
+ScratchPool& LocalPool() {
+  thread_local ScratchPool pool;
+  return pool;
+}
+
+}  // namespace
+
+std::pmr::memory_resource* ScratchResource() { return &LocalPool(); }
+
+}  // namespace internal
+
+ScratchStats GetScratchStats() { return internal::LocalPool().GetStats(); }
+
+void ReleaseScratch() { internal::LocalPool().Release(); }
+
+}  // namespace xMatrix
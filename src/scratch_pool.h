@@ -0,0 +1,39 @@
+#ifndef XMATRIX_SCRATCH_POOL_H
+#define XMATRIX_SCRATCH_POOL_H
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace xMatrix {
+
+// Each thread that has used its scratch pool, the thread pool workers
+// included, keeps up to this many bytes of free buffers until it exits.
+// Buffers freed while the cache is full go back to the upstream allocator.
+constexpr std::size_t kScratchCacheLimit = std::size_t{32} << 20;
+
+// Counters of the calling thread's scratch pool, which recycles the buffers
+// of temporaries created inside Determinant(), InverseMatrix(),
+// CalcComplements(), MulMatrix() and the product kernels. Once the pool is
+// warm those calls make no global allocator calls, so hits grow while misses
+// stay flat.
+struct ScratchStats {
+  std::size_t hits;          // requests served from a cached buffer
+  std::size_t misses;        // requests passed on to the upstream allocator
+  std::size_t bytes_cached;  // bytes held in free buffers right now
+};
+
+[[nodiscard]] ScratchStats GetScratchStats();
+// Returns the calling thread's cached buffers to the upstream allocator and
+// zeroes its counters. The caches of other threads are left alone.
+void ReleaseScratch();
+
+namespace internal {
+
+// Thread-local memory resource for temporaries. Memory taken from it must be
+// returned on the same thread and must not outlive the call that took it, so
+// it is never used for matrices handed back to the caller.
+std::pmr::memory_resource* ScratchResource();
+
+}  // namespace internal
+}  // namespace xMatrix
+#endif  // XMATRIX_SCRATCH_POOL_H
@@ -0,0 +1,363 @@
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(XMATRIX_X86_DISPATCH)
+#include <immintrin.h>
+#endif
+
+namespace xMatrix {
+namespace internal {
+
+namespace {
+
+// EqualWithin checks for a mismatch once per chunk instead of per element.
+constexpr size_t kCompareChunk = 64;
+
+template <typename T>
+struct ElementwiseKernels {
+  void (*add)(T*, const T*, size_t);
+  void (*sub)(T*, const T*, size_t);
+  void (*scale)(T*, T, size_t);
+  bool (*equal_within)(const T*, const T*, size_t, T);
+};
+
+struct Kernels {
+  SimdLevel level;
+  ElementwiseKernels<double> f64;
+  ElementwiseKernels<float> f32;
+  void (*transpose)(const double*, std::ptrdiff_t, double*, std::ptrdiff_t,
+                    int, int);
+};
+
+template <typename T>
+void AddScalar(T* dst, const T* src, const size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] += src[i];
+}
+
+template <typename T>
+void SubScalar(T* dst, const T* src, const size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] -= src[i];
+}
+
+template <typename T>
+void ScaleScalar(T* dst, const T factor, const size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] *= factor;
+}
+
+template <typename T>
+bool EqualWithinScalar(const T* a, const T* b, const size_t n, const T eps) {
+  for (size_t i = 0; i < n; i++)
+    if (std::fabs(a[i] - b[i]) >= eps) return false;
+
+  return true;
+}
+
+template <typename T>
+constexpr ElementwiseKernels<T> kScalarKernels = {
+    AddScalar<T>, SubScalar<T>, ScaleScalar<T>, EqualWithinScalar<T>};
+
+void TransposeScalar(const double* src, const std::ptrdiff_t lds, double* dst,
+                     const std::ptrdiff_t ldd, const int rows,
+                     const int cols) {
+  Transpose<double>(src, lds, dst, ldd, rows, cols);
+}
+
+#if defined(XMATRIX_X86_DISPATCH)
+
+// Each instruction set and element type gets the same four kernels; the
+// remaining arguments name the intrinsics and the scalar loops handle the
+// tail.
+#define XMATRIX_DEFINE_KERNELS(SUFFIX, TARGET, TYPE, WIDTH, VEC, LOAD, STORE,  \
+                               ADD, SUB, MUL, SET1, ABS_MASK, AND, CMP_GE,     \
+                               ANY)                                            \
+  __attribute__((target(TARGET))) void Add##SUFFIX(                            \
+      TYPE* dst, const TYPE* src, const size_t n) {                            \
+    size_t i = 0;                                                              \
+    for (; i + WIDTH <= n; i += WIDTH)                                         \
+      STORE(dst + i, ADD(LOAD(dst + i), LOAD(src + i)));                       \
+    AddScalar(dst + i, src + i, n - i);                                        \
+  }                                                                            \
+                                                                               \
+  __attribute__((target(TARGET))) void Sub##SUFFIX(                            \
+      TYPE* dst, const TYPE* src, const size_t n) {                            \
+    size_t i = 0;                                                              \
+    for (; i + WIDTH <= n; i += WIDTH)                                         \
+      STORE(dst + i, SUB(LOAD(dst + i), LOAD(src + i)));                       \
+    SubScalar(dst + i, src + i, n - i);                                        \
+  }                                                                            \
+                                                                               \
+  __attribute__((target(TARGET))) void Scale##SUFFIX(                          \
+      TYPE* dst, const TYPE factor, const size_t n) {                          \
+    const VEC f = SET1(factor);                                                \
+    size_t i = 0;                                                              \
+    for (; i + WIDTH <= n; i += WIDTH) STORE(dst + i, MUL(LOAD(dst + i), f));  \
+    ScaleScalar(dst + i, factor, n - i);                                       \
+  }                                                                            \
+                                                                               \
+  __attribute__((target(TARGET))) bool EqualWithin##SUFFIX(                    \
+      const TYPE* a, const TYPE* b, const size_t n, const TYPE eps) {          \
+    const VEC e = SET1(eps);                                                   \
+    const VEC abs_mask = ABS_MASK;                                             \
+    size_t i = 0;                                                              \
+    while (i + WIDTH <= n) {                                                   \
+      const size_t end = i + kCompareChunk < n ? i + kCompareChunk : n;        \
+      bool mismatch = false;                                                   \
+      for (; i + WIDTH <= end; i += WIDTH) {                                   \
+        const VEC diff = AND(SUB(LOAD(a + i), LOAD(b + i)), abs_mask);         \
+        mismatch |= ANY(CMP_GE(diff, e));                                      \
+      }                                                                        \
+      if (mismatch) return false;                                              \
+    }                                                                          \
+    return EqualWithinScalar(a + i, b + i, n - i, eps);                        \
+  }
+
+#define XMATRIX_SSE2_ABS _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffff))
+#define XMATRIX_SSE2_GE(x, y) _mm_cmpge_pd(x, y)
+#define XMATRIX_SSE2_ANY(m) (_mm_movemask_pd(m) != 0)
+XMATRIX_DEFINE_KERNELS(Sse2, "sse2", double, 2, __m128d, _mm_loadu_pd,
+                       _mm_storeu_pd, _mm_add_pd, _mm_sub_pd, _mm_mul_pd,
+                       _mm_set1_pd, XMATRIX_SSE2_ABS, _mm_and_pd,
+                       XMATRIX_SSE2_GE, XMATRIX_SSE2_ANY)
+
+#define XMATRIX_SSE2_ABS_PS _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff))
+#define XMATRIX_SSE2_GE_PS(x, y) _mm_cmpge_ps(x, y)
+#define XMATRIX_SSE2_ANY_PS(m) (_mm_movemask_ps(m) != 0)
+XMATRIX_DEFINE_KERNELS(Sse2F, "sse2", float, 4, __m128, _mm_loadu_ps,
+                       _mm_storeu_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps,
+                       _mm_set1_ps, XMATRIX_SSE2_ABS_PS, _mm_and_ps,
+                       XMATRIX_SSE2_GE_PS, XMATRIX_SSE2_ANY_PS)
+
+#define XMATRIX_AVX2_ABS \
+  _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffff))
+#define XMATRIX_AVX2_GE(x, y) _mm256_cmp_pd(x, y, _CMP_GE_OQ)
+#define XMATRIX_AVX2_ANY(m) (_mm256_movemask_pd(m) != 0)
+XMATRIX_DEFINE_KERNELS(Avx2, "avx2", double, 4, __m256d, _mm256_loadu_pd,
+                       _mm256_storeu_pd, _mm256_add_pd, _mm256_sub_pd,
+                       _mm256_mul_pd, _mm256_set1_pd, XMATRIX_AVX2_ABS,
+                       _mm256_and_pd, XMATRIX_AVX2_GE, XMATRIX_AVX2_ANY)
+
+#define XMATRIX_AVX2_ABS_PS \
+  _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff))
+#define XMATRIX_AVX2_GE_PS(x, y) _mm256_cmp_ps(x, y, _CMP_GE_OQ)
+#define XMATRIX_AVX2_ANY_PS(m) (_mm256_movemask_ps(m) != 0)
+XMATRIX_DEFINE_KERNELS(Avx2F, "avx2", float, 8, __m256, _mm256_loadu_ps,
+                       _mm256_storeu_ps, _mm256_add_ps, _mm256_sub_ps,
+                       _mm256_mul_ps, _mm256_set1_ps, XMATRIX_AVX2_ABS_PS,
+                       _mm256_and_ps, XMATRIX_AVX2_GE_PS, XMATRIX_AVX2_ANY_PS)
+
+#define XMATRIX_AVX512_ABS \
+  _mm512_castsi512_pd(_mm512_set1_epi64(0x7fffffffffffffff))
+#define XMATRIX_AVX512_AND(x, y) \
+  _mm512_castsi512_pd(           \
+      _mm512_and_si512(_mm512_castpd_si512(x), _mm512_castpd_si512(y)))
+#define XMATRIX_AVX512_GE(x, y) _mm512_cmp_pd_mask(x, y, _CMP_GE_OQ)
+#define XMATRIX_AVX512_ANY(m) ((m) != 0)
+XMATRIX_DEFINE_KERNELS(Avx512, "avx512f", double, 8, __m512d, _mm512_loadu_pd,
+                       _mm512_storeu_pd, _mm512_add_pd, _mm512_sub_pd,
+                       _mm512_mul_pd, _mm512_set1_pd, XMATRIX_AVX512_ABS,
+                       XMATRIX_AVX512_AND, XMATRIX_AVX512_GE,
+                       XMATRIX_AVX512_ANY)
+
+#define XMATRIX_AVX512_ABS_PS \
+  _mm512_castsi512_ps(_mm512_set1_epi32(0x7fffffff))
+#define XMATRIX_AVX512_AND_PS(x, y) \
+  _mm512_castsi512_ps(              \
+      _mm512_and_si512(_mm512_castps_si512(x), _mm512_castps_si512(y)))
+#define XMATRIX_AVX512_GE_PS(x, y) _mm512_cmp_ps_mask(x, y, _CMP_GE_OQ)
+XMATRIX_DEFINE_KERNELS(Avx512F, "avx512f", float, 16, __m512, _mm512_loadu_ps,
+                       _mm512_storeu_ps, _mm512_add_ps, _mm512_sub_ps,
+                       _mm512_mul_ps, _mm512_set1_ps, XMATRIX_AVX512_ABS_PS,
+                       XMATRIX_AVX512_AND_PS, XMATRIX_AVX512_GE_PS,
+                       XMATRIX_AVX512_ANY)
+
+// Register tiles for Transpose: TILE x TILE elements are loaded as rows and
+// stored as columns after an in-register shuffle.
+__attribute__((target("sse2"))) inline void TransposeTileSse2(
+    const double* src, const std::ptrdiff_t lds, double* dst,
+    const std::ptrdiff_t ldd) {
+  const __m128d r0 = _mm_loadu_pd(src);
+  const __m128d r1 = _mm_loadu_pd(src + lds);
+  _mm_storeu_pd(dst, _mm_unpacklo_pd(r0, r1));
+  _mm_storeu_pd(dst + ldd, _mm_unpackhi_pd(r0, r1));
+}
+
+__attribute__((target("avx2"))) inline void TransposeTileAvx2(
+    const double* src, const std::ptrdiff_t lds, double* dst,
+    const std::ptrdiff_t ldd) {
+  const __m256d r0 = _mm256_loadu_pd(src);
+  const __m256d r1 = _mm256_loadu_pd(src + lds);
+  const __m256d r2 = _mm256_loadu_pd(src + 2 * lds);
+  const __m256d r3 = _mm256_loadu_pd(src + 3 * lds);
+  // t0 = {r0[0], r1[0], r0[2], r1[2]}, t1 = {r0[1], r1[1], r0[3], r1[3]}, ...
+  const __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+  const __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+  const __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+  const __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+  _mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+  _mm256_storeu_pd(dst + ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+  _mm256_storeu_pd(dst + 2 * ldd, _mm256_permute2f128_pd(t0, t2, 0x31));
+  _mm256_storeu_pd(dst + 3 * ldd, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+// Blocked transpose built on a register tile; the block edges that do not
+// fill a tile are copied element by element.
+#define XMATRIX_DEFINE_TRANSPOSE(SUFFIX, TARGET, TILE, TILE_FN)                \
+  __attribute__((target(TARGET))) void Transpose##SUFFIX(                      \
+      const double* src, const std::ptrdiff_t lds, double* dst,                \
+      const std::ptrdiff_t ldd, const int rows, const int cols) {              \
+    for (int ib = 0; ib < rows; ib += kTransposeBlock) {                       \
+      const int ie = std::min(rows, ib + kTransposeBlock);                     \
+      for (int jb = 0; jb < cols; jb += kTransposeBlock) {                     \
+        const int je = std::min(cols, jb + kTransposeBlock);                   \
+        int i = ib;                                                            \
+        for (; i + TILE <= ie; i += TILE) {                                    \
+          int j = jb;                                                          \
+          for (; j + TILE <= je; j += TILE)                                    \
+            TILE_FN(src + i * lds + j, lds, dst + j * ldd + i, ldd);           \
+          for (; j < je; j++)                                                  \
+            for (int r = i; r < i + TILE; r++)                                 \
+              dst[j * ldd + r] = src[r * lds + j];                             \
+        }                                                                      \
+        for (; i < ie; i++)                                                    \
+          for (int j = jb; j < je; j++) dst[j * ldd + i] = src[i * lds + j];   \
+      }                                                                        \
+    }                                                                          \
+  }
+
+XMATRIX_DEFINE_TRANSPOSE(Sse2, "sse2", 2, TransposeTileSse2)
+XMATRIX_DEFINE_TRANSPOSE(Avx2Aligned, "avx2", 4, TransposeTileAvx2)
+
+// A 32-byte tile row that straddles a cache line costs twice as much as two
+// 16-byte ones, so the AVX2 tile is only used when every row is aligned.
+void TransposeAvx2(const double* src, const std::ptrdiff_t lds, double* dst,
+                   const std::ptrdiff_t ldd, const int rows, const int cols) {
+  const auto misaligned = (reinterpret_cast<std::uintptr_t>(src) |
+                           reinterpret_cast<std::uintptr_t>(dst)) % 32 |
+                          (lds | ldd) % 4;
+  if (misaligned != 0) {
+    TransposeSse2(src, lds, dst, ldd, rows, cols);
+  } else {
+    TransposeAvx2Aligned(src, lds, dst, ldd, rows, cols);
+  }
+}
+
+#endif  // XMATRIX_X86_DISPATCH
+
+SimdLevel MaxSupportedLevel() {
+#if defined(XMATRIX_X86_DISPATCH)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return SimdLevel::kAvx512;
+  if (__builtin_cpu_supports("avx2")) return SimdLevel::kAvx2;
+  if (__builtin_cpu_supports("sse2")) return SimdLevel::kSse2;
+#endif
+  return SimdLevel::kScalar;
+}
+
+SimdLevel RequestedLevel(const SimdLevel supported) {
+  const char* env = std::getenv("XMATRIX_SIMD");
+  if (env == nullptr) return supported;
+
+  SimdLevel requested = supported;
+  if (std::strcmp(env, "scalar") == 0) requested = SimdLevel::kScalar;
+  if (std::strcmp(env, "sse2") == 0) requested = SimdLevel::kSse2;
+  if (std::strcmp(env, "avx2") == 0) requested = SimdLevel::kAvx2;
+  if (std::strcmp(env, "avx512") == 0) requested = SimdLevel::kAvx512;
+
+  return requested < supported ? requested : supported;
+}
+
+Kernels SelectKernels() {
+  switch (RequestedLevel(MaxSupportedLevel())) {
+#if defined(XMATRIX_X86_DISPATCH)
+    case SimdLevel::kAvx512:
+      // A 4x4 tile already moves a whole cache line per row; wider shuffles
+      // gain nothing for a memory-bound transpose.
+      return {SimdLevel::kAvx512,
+              {AddAvx512, SubAvx512, ScaleAvx512, EqualWithinAvx512},
+              {AddAvx512F, SubAvx512F, ScaleAvx512F, EqualWithinAvx512F},
+              TransposeAvx2};
+    case SimdLevel::kAvx2:
+      return {SimdLevel::kAvx2,
+              {AddAvx2, SubAvx2, ScaleAvx2, EqualWithinAvx2},
+              {AddAvx2F, SubAvx2F, ScaleAvx2F, EqualWithinAvx2F},
+              TransposeAvx2};
+    case SimdLevel::kSse2:
+      return {SimdLevel::kSse2,
+              {AddSse2, SubSse2, ScaleSse2, EqualWithinSse2},
+              {AddSse2F, SubSse2F, ScaleSse2F, EqualWithinSse2F},
+              TransposeSse2};
+#endif
+    default:
+      return {SimdLevel::kScalar, kScalarKernels<double>,
+              kScalarKernels<float>, TransposeScalar};
+  }
+}
+
+const Kernels& GetKernels() {
+  static const Kernels kernels = SelectKernels();
+  return kernels;
+}
+
+}  // namespace
+
+void Add(double* dst, const double* src, const size_t n) {
+  GetKernels().f64.add(dst, src, n);
+}
+
+void Add(float* dst, const float* src, const size_t n) {
+  GetKernels().f32.add(dst, src, n);
+}
+
+void Sub(double* dst, const double* src, const size_t n) {
+  GetKernels().f64.sub(dst, src, n);
+}
+
+void Sub(float* dst, const float* src, const size_t n) {
+  GetKernels().f32.sub(dst, src, n);
+}
+
+void Scale(double* dst, const double factor, const size_t n) {
+  GetKernels().f64.scale(dst, factor, n);
+}
+
+void Scale(float* dst, const float factor, const size_t n) {
+  GetKernels().f32.scale(dst, factor, n);
+}
+
+bool EqualWithin(const double* a, const double* b, const size_t n,
+                 const double eps) {
+  return GetKernels().f64.equal_within(a, b, n, eps);
+}
+
+bool EqualWithin(const float* a, const float* b, const size_t n,
+                 const float eps) {
+  return GetKernels().f32.equal_within(a, b, n, eps);
+}
+
+void Transpose(const double* src, const std::ptrdiff_t lds, double* dst,
+               const std::ptrdiff_t ldd, const int rows, const int cols) {
+  GetKernels().transpose(src, lds, dst, ldd, rows, cols);
+}
+
+SimdLevel GetSimdLevel() { return GetKernels().level; }
+
+const char* SimdLevelName() {
+  switch (GetKernels().level) {
+    case SimdLevel::kAvx512:
+      return "avx512";
+    case SimdLevel::kAvx2:
+      return "avx2";
+    case SimdLevel::kSse2:
+      return "sse2";
+    default:
+      return "scalar";
+  }
+}
+
+}  // namespace internal
+}  // namespace xMatrix
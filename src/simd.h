@@ -0,0 +1,91 @@
+#ifndef XMATRIX_SIMD_H
+#define XMATRIX_SIMD_H
+
+#include <algorithm>
+#include <cstddef>
+
+#include "scalar_traits.h"
+
+// Per-ISA kernel variants are built with GCC/Clang target attributes and
+// selected at run time; elsewhere only the scalar kernels exist.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define XMATRIX_X86_DISPATCH 1
+#endif
+
+namespace xMatrix {
+namespace internal {
+
+enum class SimdLevel { kScalar, kSse2, kAvx2, kAvx512 };
+
+// Instruction set picked for this process; other kernels that carry their
+// own per-ISA variants dispatch on it too.
+SimdLevel GetSimdLevel();
+
+// Element-wise kernels over flat buffers. The widest instruction set the CPU
+// supports is picked once at start-up; XMATRIX_SIMD=scalar|sse2|avx2|avx512
+// caps it for testing. float gets twice as many lanes per register as double.
+void Add(double* dst, const double* src, size_t n);
+void Add(float* dst, const float* src, size_t n);
+void Sub(double* dst, const double* src, size_t n);
+void Sub(float* dst, const float* src, size_t n);
+void Scale(double* dst, double factor, size_t n);
+void Scale(float* dst, float factor, size_t n);
+// True when |a[i] - b[i]| < eps for every i.
+bool EqualWithin(const double* a, const double* b, size_t n, double eps);
+bool EqualWithin(const float* a, const float* b, size_t n, float eps);
+
+// dst = src^T, where src is rows x cols with row stride lds and dst is
+// cols x rows with row stride ldd; the buffers must not overlap. Works in
+// cache-sized blocks of register-sized tiles.
+void Transpose(const double* src, std::ptrdiff_t lds, double* dst,
+               std::ptrdiff_t ldd, int rows, int cols);
+
+// Element types without vector kernels (long double, complex) use plain
+// loops; the overloads above win for float and double.
+template <typename T>
+void Add(T* dst, const T* src, const size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] += src[i];
+}
+
+template <typename T>
+void Sub(T* dst, const T* src, const size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] -= src[i];
+}
+
+template <typename T>
+void Scale(T* dst, const T factor, const size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] *= factor;
+}
+
+template <typename T>
+bool EqualWithin(const T* a, const T* b, const size_t n,
+                 const RealType<T> eps) {
+  for (size_t i = 0; i < n; i++)
+    if (std::abs(a[i] - b[i]) >= eps) return false;
+
+  return true;
+}
+
+// Transpose works on square blocks small enough that the rows read and the
+// rows written all stay in L1 while a block is done.
+constexpr int kTransposeBlock = 32;
+
+template <typename T>
+void Transpose(const T* src, const std::ptrdiff_t lds, T* dst,
+               const std::ptrdiff_t ldd, const int rows, const int cols) {
+  for (int ib = 0; ib < rows; ib += kTransposeBlock) {
+    const int ie = std::min(rows, ib + kTransposeBlock);
+    for (int jb = 0; jb < cols; jb += kTransposeBlock) {
+      const int je = std::min(cols, jb + kTransposeBlock);
+      for (int i = ib; i < ie; i++)
+        for (int j = jb; j < je; j++) dst[j * ldd + i] = src[i * lds + j];
+    }
+  }
+}
+
+// Name of the instruction set in use: "scalar", "sse2", "avx2" or "avx512".
+const char* SimdLevelName();
+
+}  // namespace internal
+}  // namespace xMatrix
+#endif  // XMATRIX_SIMD_H
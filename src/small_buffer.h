@@ -0,0 +1,126 @@
+#ifndef XMATRIX_SMALL_BUFFER_H
+#define XMATRIX_SMALL_BUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+#include "aligned_allocator.h"
+
+namespace xMatrix {
+namespace internal {
+
+// Contiguous element buffer with room for N elements inside the object;
+// larger sizes spill to memory from an AlignedAllocator. The interface is the
+// subset of std::vector that Matrix uses, so small matrices cost no heap
+// allocation to create, copy or move. Allocator propagation follows
+// AlignedAllocator: copies take the default resource, moves keep theirs.
+template <typename T, std::size_t N>
+class SmallBuffer {
+ public:
+  using value_type = T;
+  using allocator_type = AlignedAllocator<T>;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  SmallBuffer() = default;
+  explicit SmallBuffer(const std::size_t n, const T& value = T(),
+                       const allocator_type& allocator = allocator_type())
+      : allocator_(allocator) {
+    Allocate(n);
+    std::fill_n(data_, n, value);
+  }
+  SmallBuffer(const SmallBuffer& o)
+      : allocator_(o.allocator_.select_on_container_copy_construction()) {
+    Allocate(o.size_);
+    std::copy_n(o.data_, o.size_, data_);
+  }
+  SmallBuffer(SmallBuffer&& o) noexcept : allocator_(o.allocator_) {
+    Steal(o);
+  }
+  ~SmallBuffer() { Deallocate(); }
+
+  SmallBuffer& operator=(const SmallBuffer& o) {
+    if (this != &o) assign(o.begin(), o.end());
+    return *this;
+  }
+
+  SmallBuffer& operator=(SmallBuffer&& o) noexcept {
+    if (this != &o) {
+      Deallocate();
+      allocator_ = o.allocator_;
+      Steal(o);
+    }
+    return *this;
+  }
+
+  // Replaces the contents, reusing the current storage when it is large
+  // enough. The range must not point into this buffer.
+  template <typename It>
+  void assign(It first, It last) {
+    const auto n = static_cast<std::size_t>(std::distance(first, last));
+    if (n > capacity_) {
+      Deallocate();
+      Allocate(n);
+    }
+    size_ = n;
+    std::copy(first, last, data_);
+  }
+
+  [[nodiscard]] T* data() { return data_; }
+  [[nodiscard]] const T* data() const { return data_; }
+  [[nodiscard]] std::size_t size() const { return size_; }
+  [[nodiscard]] bool empty() const { return size_ == 0; }
+  // True while the elements live inside the object.
+  [[nodiscard]] bool IsInline() const { return data_ == inline_; }
+  [[nodiscard]] allocator_type get_allocator() const { return allocator_; }
+
+  T& operator[](const std::size_t i) { return data_[i]; }
+  const T& operator[](const std::size_t i) const { return data_[i]; }
+
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+
+ private:
+  void Allocate(const std::size_t n) {
+    if (n > N) {
+      data_ = allocator_.allocate(n);
+      capacity_ = n;
+    }
+    size_ = n;
+  }
+
+  void Deallocate() {
+    if (!IsInline()) allocator_.deallocate(data_, capacity_);
+    data_ = inline_;
+    capacity_ = N;
+    size_ = 0;
+  }
+
+  // Takes o's elements, leaving o empty; o's heap block changes hands, its
+  // inline elements are copied.
+  void Steal(SmallBuffer& o) noexcept {
+    if (o.IsInline()) {
+      std::copy_n(o.inline_, o.size_, inline_);
+    } else {
+      data_ = o.data_;
+      capacity_ = o.capacity_;
+      o.data_ = o.inline_;
+      o.capacity_ = N;
+    }
+    size_ = o.size_;
+    o.size_ = 0;
+  }
+
+  alignas(kMatrixAlignment) T inline_[N];
+  T* data_ = inline_;
+  std::size_t size_ = 0;
+  std::size_t capacity_ = N;
+  allocator_type allocator_;
+};
+
+}  // namespace internal
+}  // namespace xMatrix
+#endif  // XMATRIX_SMALL_BUFFER_H
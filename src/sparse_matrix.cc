@@ -0,0 +1,646 @@
+#include "sparse_matrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "thread_pool.h"
+
+namespace xMatrix {
+
+namespace {
+
+using internal::ThreadPool;
+
+// Products with fewer multiply-adds than this run on the calling thread.
+constexpr long kParallelWork = 1L << 16;
+// Each thread gets a few chunks so one dense row cannot hold up the others.
+constexpr int kChunksPerThread = 4;
+// Columns of the dense operand handled by one task of a CSC product.
+constexpr int kDenseSlice = 64;
+
+SparseFormat Other(const SparseFormat format) {
+  return format == SparseFormat::kCsr ? SparseFormat::kCsc : SparseFormat::kCsr;
+}
+
+void CheckDimensions(const int rows, const int cols) {
+  if (rows < 1 || cols < 1) {
+    throw std::invalid_argument(
+        "Input arguments must be positive and not equal to zero");
+  }
+}
+
+// Splits [0, offsets.size() - 1) into at most chunks ranges holding about the
+// same number of nonzeros.
+std::vector<int> Partition(const std::vector<int>& offsets, const int chunks) {
+  const int major = static_cast<int>(offsets.size()) - 1;
+  const long nonzeros = offsets.back();
+  std::vector<int> bounds{0};
+
+  for (int c = 1; c < chunks; c++) {
+    const long target = nonzeros * c / chunks;
+    const int bound = static_cast<int>(
+        std::lower_bound(offsets.begin(), offsets.end(), target) -
+        offsets.begin());
+    if (bound > bounds.back() && bound < major) bounds.push_back(bound);
+  }
+  bounds.push_back(major);
+
+  return bounds;
+}
+
+// Calls body(begin, end) over chunks of the major dimension described by
+// offsets, in parallel when work (multiply-adds) is large enough.
+template <typename Body>
+void ForEachChunk(const std::vector<int>& offsets, const long work,
+                  const Body& body) {
+  ThreadPool& pool = ThreadPool::Instance();
+  const int threads = pool.GetNumThreads();
+
+  if (work < kParallelWork || threads == 1) {
+    body(0, static_cast<int>(offsets.size()) - 1);
+    return;
+  }
+
+  const std::vector<int> bounds =
+      Partition(offsets, threads * kChunksPerThread);
+  pool.ParallelFor(static_cast<int>(bounds.size()) - 1, [&](const int i) {
+    body(bounds[i], bounds[i + 1]);
+  });
+}
+
+// Calls scatter(begin, end, out) over chunks of the columns of a CSC matrix
+// described by offsets, each adding the contributions of its columns into
+// out, an array of size elements laid out like result. In parallel every
+// chunk but the first scatters into a private zeroed copy, one per thread,
+// and the copies are then summed into result block by block.
+template <typename T, typename Scatter>
+void ScatterChunks(const std::vector<int>& offsets, const long work,
+                   const std::size_t size, T* result, const Scatter& scatter) {
+  ThreadPool& pool = ThreadPool::Instance();
+  const int threads = pool.GetNumThreads();
+
+  if (work < kParallelWork || threads == 1) {
+    scatter(0, static_cast<int>(offsets.size()) - 1, result);
+    return;
+  }
+
+  const std::vector<int> bounds = Partition(offsets, threads);
+  const int chunks = static_cast<int>(bounds.size()) - 1;
+  std::vector<std::vector<T>> partials(chunks - 1);
+  pool.ParallelFor(chunks, [&](const int i) {
+    T* out = result;
+    if (i > 0) {
+      partials[i - 1].assign(size, T());
+      out = partials[i - 1].data();
+    }
+    scatter(bounds[i], bounds[i + 1], out);
+  });
+
+  const std::size_t block = (size + threads - 1) / threads;
+  pool.ParallelFor(threads, [&](const int t) {
+    const std::size_t first = t * block, last = std::min(size, first + block);
+    for (const std::vector<T>& partial : partials)
+      for (std::size_t e = first; e < last; e++) result[e] += partial[e];
+  });
+}
+
+// Counting-sort transpose of compressed arrays: the segments of the result
+// are the minor indices of the input, in order, with sorted indices.
+template <typename T>
+void TransposeArrays(const int minor, const std::vector<int>& offsets,
+                     const std::vector<int>& indices,
+                     const std::vector<T>& values, std::vector<int>& t_offsets,
+                     std::vector<int>& t_indices, std::vector<T>& t_values) {
+  const int major = static_cast<int>(offsets.size()) - 1;
+
+  t_offsets.assign(minor + 1, 0);
+  for (const int index : indices) t_offsets[index + 1]++;
+  for (int i = 0; i < minor; i++) t_offsets[i + 1] += t_offsets[i];
+
+  t_indices.resize(indices.size());
+  t_values.resize(values.size());
+  std::vector<int> next(t_offsets.begin(), t_offsets.end() - 1);
+
+  for (int i = 0; i < major; i++) {
+    for (int p = offsets[i]; p < offsets[i + 1]; p++) {
+      const int q = next[indices[p]]++;
+      t_indices[q] = i;
+      t_values[q] = values[p];
+    }
+  }
+}
+
+// Gustavson's algorithm: segment i of the result is the sum over the entries
+// (k, v) of segment i of left of v times segment k of right. Both CSR * CSR
+// (left = A, right = B) and CSC * CSC (left = B, right = A) take this form.
+// Each chunk gathers its segments in a dense accumulator indexed by minor
+// index, then the chunks are stitched together in order.
+template <typename T>
+void MultiplyArrays(const int minor, const std::vector<int>& l_offsets,
+                    const std::vector<int>& l_indices,
+                    const std::vector<T>& l_values,
+                    const std::vector<int>& r_offsets,
+                    const std::vector<int>& r_indices,
+                    const std::vector<T>& r_values, std::vector<int>& offsets,
+                    std::vector<int>& indices, std::vector<T>& values) {
+  const int major = static_cast<int>(l_offsets.size()) - 1;
+
+  long work = 0;
+  for (const int k : l_indices) work += r_offsets[k + 1] - r_offsets[k];
+
+  struct Chunk {
+    int begin;
+    std::vector<int> indices;
+    std::vector<T> values;
+  };
+  std::vector<int> counts(major, 0);
+  std::vector<Chunk> chunks;
+  std::mutex chunks_mutex;
+
+  ForEachChunk(l_offsets, work, [&](const int begin, const int end) {
+    // Entries of mark are -1 except while their index is in touched.
+    thread_local std::vector<T> accumulator;
+    thread_local std::vector<int> mark;
+    if (static_cast<int>(mark.size()) < minor) {
+      accumulator.resize(minor);
+      mark.resize(minor, -1);
+    }
+
+    Chunk chunk{begin, {}, {}};
+    std::vector<int> touched;
+    // Clears the marks of a row left half done by an exception, so they
+    // cannot pass for marks of a later product on this thread.
+    struct MarkReset {
+      std::vector<int>& mark;
+      const std::vector<int>& touched;
+      ~MarkReset() {
+        for (const int j : touched) mark[j] = -1;
+      }
+    } reset{mark, touched};
+
+    for (int i = begin; i < end; i++) {
+      for (int p = l_offsets[i]; p < l_offsets[i + 1]; p++) {
+        const int k = l_indices[p];
+        const T v = l_values[p];
+        for (int q = r_offsets[k]; q < r_offsets[k + 1]; q++) {
+          const int j = r_indices[q];
+          if (mark[j] != i) {
+            mark[j] = i;
+            accumulator[j] = T();
+            touched.push_back(j);
+          }
+          accumulator[j] += v * r_values[q];
+        }
+      }
+
+      std::sort(touched.begin(), touched.end());
+      for (const int j : touched) {
+        if (accumulator[j] != T()) {
+          chunk.indices.push_back(j);
+          chunk.values.push_back(accumulator[j]);
+          counts[i]++;
+        }
+        mark[j] = -1;
+      }
+      touched.clear();
+    }
+
+    const std::lock_guard<std::mutex> lock(chunks_mutex);
+    chunks.push_back(std::move(chunk));
+  });
+
+  std::sort(chunks.begin(), chunks.end(),
+            [](const Chunk& a, const Chunk& b) { return a.begin < b.begin; });
+
+  offsets.assign(major + 1, 0);
+  for (int i = 0; i < major; i++) offsets[i + 1] = offsets[i] + counts[i];
+
+  indices.clear();
+  values.clear();
+  indices.reserve(offsets.back());
+  values.reserve(offsets.back());
+  for (Chunk& chunk : chunks) {
+    indices.insert(indices.end(), chunk.indices.begin(), chunk.indices.end());
+    values.insert(values.end(), chunk.values.begin(), chunk.values.end());
+  }
+}
+
+}  // namespace
+
+// CONSTRUCTORS
+template <typename T>
+BasicSparseMatrix<T>::BasicSparseMatrix(const int rows, const int cols,
+                                        const SparseFormat format)
+    : rows_(rows), cols_(cols), format_(format) {
+  CheckDimensions(rows, cols);
+  offsets_.assign(MajorSize() + 1, 0);
+}
+
+template <typename T>
+BasicSparseMatrix<T>::BasicSparseMatrix(const int rows, const int cols,
+                                        const SparseFormat format,
+                                        std::vector<int> offsets,
+                                        std::vector<int> indices,
+                                        std::vector<T> values)
+    : rows_(rows),
+      cols_(cols),
+      format_(format),
+      offsets_(std::move(offsets)),
+      indices_(std::move(indices)),
+      values_(std::move(values)) {
+  CheckDimensions(rows, cols);
+
+  const int major = MajorSize();
+  const int minor = format_ == SparseFormat::kCsr ? cols_ : rows_;
+
+  if (static_cast<int>(offsets_.size()) != major + 1 || offsets_[0] != 0 ||
+      offsets_.back() != static_cast<int>(indices_.size()) ||
+      indices_.size() != values_.size()) {
+    throw std::invalid_argument("Compressed arrays are inconsistent");
+  }
+
+  for (int i = 0; i < major; i++) {
+    if (offsets_[i] > offsets_[i + 1]) {
+      throw std::invalid_argument("Compressed arrays are inconsistent");
+    }
+    for (int p = offsets_[i]; p < offsets_[i + 1]; p++) {
+      if (indices_[p] < 0 || indices_[p] >= minor ||
+          (p > offsets_[i] && indices_[p] <= indices_[p - 1])) {
+        throw std::invalid_argument("Incorrect index");
+      }
+    }
+  }
+}
+
+template <typename T>
+BasicSparseMatrix<T>::BasicSparseMatrix(const BasicMatrix<T>& dense,
+                                        const SparseFormat format)
+    : rows_(dense.GetRows()), cols_(dense.GetCols()), format_(format) {
+  const int major = MajorSize();
+  const int minor = format_ == SparseFormat::kCsr ? cols_ : rows_;
+  offsets_.reserve(major + 1);
+  offsets_.push_back(0);
+
+  for (int i = 0; i < major; i++) {
+    for (int j = 0; j < minor; j++) {
+      const T value = format_ == SparseFormat::kCsr ? dense.UncheckedAt(i, j)
+                                                    : dense.UncheckedAt(j, i);
+      if (value != T()) {
+        indices_.push_back(j);
+        values_.push_back(value);
+      }
+    }
+    offsets_.push_back(static_cast<int>(indices_.size()));
+  }
+}
+
+template <typename T>
+BasicSparseMatrix<T> BasicSparseMatrix<T>::FromTriplets(
+    const int rows, const int cols, const std::vector<Triplet>& triplets,
+    const SparseFormat format) {
+  BasicSparseMatrix result(rows, cols, format);
+  const bool csr = format == SparseFormat::kCsr;
+  const int major = result.MajorSize();
+
+  for (const Triplet& t : triplets) {
+    if (t.row < 0 || t.row >= rows || t.col < 0 || t.col >= cols) {
+      throw std::invalid_argument("Incorrect index");
+    }
+    result.offsets_[(csr ? t.row : t.col) + 1]++;
+  }
+  for (int i = 0; i < major; i++)
+    result.offsets_[i + 1] += result.offsets_[i];
+
+  // Bucket by major index, then sort each segment and merge repeats.
+  std::vector<std::pair<int, T>> entries(triplets.size());
+  std::vector<int> next(result.offsets_.begin(), result.offsets_.end() - 1);
+  for (const Triplet& t : triplets)
+    entries[next[csr ? t.row : t.col]++] = {csr ? t.col : t.row, t.value};
+
+  result.indices_.reserve(entries.size());
+  result.values_.reserve(entries.size());
+  int segment_begin = 0;
+  for (int i = 0; i < major; i++) {
+    const int segment_end = result.offsets_[i + 1];
+    std::sort(entries.begin() + segment_begin, entries.begin() + segment_end,
+              [](const std::pair<int, T>& a, const std::pair<int, T>& b) {
+                return a.first < b.first;
+              });
+
+    const int first = static_cast<int>(result.indices_.size());
+    for (int p = segment_begin; p < segment_end; p++) {
+      if (static_cast<int>(result.indices_.size()) > first &&
+          result.indices_.back() == entries[p].first) {
+        result.values_.back() += entries[p].second;
+      } else {
+        result.indices_.push_back(entries[p].first);
+        result.values_.push_back(entries[p].second);
+      }
+    }
+
+    segment_begin = segment_end;
+    result.offsets_[i + 1] = static_cast<int>(result.indices_.size());
+  }
+
+  return result;
+}
+
+// ACCESSORS
+template <typename T>
+int BasicSparseMatrix<T>::GetRows() const { return rows_; }
+
+template <typename T>
+int BasicSparseMatrix<T>::GetCols() const { return cols_; }
+
+template <typename T>
+SparseFormat BasicSparseMatrix<T>::GetFormat() const { return format_; }
+
+template <typename T>
+int BasicSparseMatrix<T>::GetNonZeros() const {
+  return static_cast<int>(indices_.size());
+}
+
+template <typename T>
+const std::vector<int>& BasicSparseMatrix<T>::GetOffsets() const {
+  return offsets_;
+}
+
+template <typename T>
+const std::vector<int>& BasicSparseMatrix<T>::GetIndices() const {
+  return indices_;
+}
+
+template <typename T>
+const std::vector<T>& BasicSparseMatrix<T>::GetValues() const {
+  return values_;
+}
+
+template <typename T>
+T BasicSparseMatrix<T>::At(const int r, const int c) const {
+  if (r >= rows_ || c >= cols_ || r < 0 || c < 0) {
+    throw std::invalid_argument("Incorrect index");
+  }
+
+  const int i = format_ == SparseFormat::kCsr ? r : c;
+  const int j = format_ == SparseFormat::kCsr ? c : r;
+  const auto first = indices_.begin() + offsets_[i];
+  const auto last = indices_.begin() + offsets_[i + 1];
+  const auto it = std::lower_bound(first, last, j);
+
+  return it != last && *it == j ? values_[it - indices_.begin()] : T();
+}
+
+template <typename T>
+int BasicSparseMatrix<T>::MajorSize() const {
+  return format_ == SparseFormat::kCsr ? rows_ : cols_;
+}
+
+// CONVERSIONS
+template <typename T>
+BasicSparseMatrix<T> BasicSparseMatrix<T>::ToFormat(
+    const SparseFormat format) const {
+  if (format == format_) return *this;
+
+  BasicSparseMatrix result(rows_, cols_, format);
+  TransposeArrays(result.MajorSize(), offsets_, indices_, values_,
+                  result.offsets_, result.indices_, result.values_);
+
+  return result;
+}
+
+template <typename T>
+BasicSparseMatrix<T> BasicSparseMatrix<T>::Transpose() const {
+  BasicSparseMatrix result = *this;
+  std::swap(result.rows_, result.cols_);
+  result.format_ = Other(format_);
+
+  return result;
+}
+
+template <typename T>
+BasicMatrix<T> BasicSparseMatrix<T>::ToMatrix() const {
+  BasicMatrix<T> result(rows_, cols_);
+
+  for (int i = 0; i < MajorSize(); i++) {
+    for (int p = offsets_[i]; p < offsets_[i + 1]; p++) {
+      if (format_ == SparseFormat::kCsr) {
+        result.UncheckedAt(i, indices_[p]) = values_[p];
+      } else {
+        result.UncheckedAt(indices_[p], i) = values_[p];
+      }
+    }
+  }
+
+  return result;
+}
+
+// OVERLOAD FUNCTIONS
+template <typename T>
+BasicSparseMatrix<T> BasicSparseMatrix<T>::operator+(
+    const BasicSparseMatrix& other) const {
+  if (rows_ != other.rows_ || cols_ != other.cols_) {
+    throw std::invalid_argument("Matrices are not of the same size");
+  }
+
+  std::optional<BasicSparseMatrix> converted;
+  if (other.format_ != format_) converted = other.ToFormat(format_);
+  const BasicSparseMatrix& b = converted ? *converted : other;
+  BasicSparseMatrix result(rows_, cols_, format_);
+  result.indices_.reserve(indices_.size() + b.indices_.size());
+  result.values_.reserve(indices_.size() + b.indices_.size());
+
+  const auto emit = [&result](const int index, const T value) {
+    if (value == T()) return;
+    result.indices_.push_back(index);
+    result.values_.push_back(value);
+  };
+
+  for (int i = 0; i < MajorSize(); i++) {
+    int p = offsets_[i], q = b.offsets_[i];
+    const int p_end = offsets_[i + 1], q_end = b.offsets_[i + 1];
+
+    while (p < p_end && q < q_end) {
+      if (indices_[p] < b.indices_[q]) {
+        emit(indices_[p], values_[p]), p++;
+      } else if (b.indices_[q] < indices_[p]) {
+        emit(b.indices_[q], b.values_[q]), q++;
+      } else {
+        emit(indices_[p], values_[p] + b.values_[q]), p++, q++;
+      }
+    }
+    for (; p < p_end; p++) emit(indices_[p], values_[p]);
+    for (; q < q_end; q++) emit(b.indices_[q], b.values_[q]);
+
+    result.offsets_[i + 1] = static_cast<int>(result.indices_.size());
+  }
+
+  return result;
+}
+
+template <typename T>
+BasicSparseMatrix<T> BasicSparseMatrix<T>::operator-(
+    const BasicSparseMatrix& other) const {
+  return *this + other * T(-1);
+}
+
+template <typename T>
+BasicSparseMatrix<T> BasicSparseMatrix<T>::operator*(
+    const BasicSparseMatrix& other) const {
+  if (cols_ != other.rows_) {
+    throw std::invalid_argument(
+        "Num of cols in the first matrix must be equal the num of rows in the "
+        "second matrix");
+  }
+
+  std::optional<BasicSparseMatrix> converted;
+  if (other.format_ != format_) converted = other.ToFormat(format_);
+  const BasicSparseMatrix& b = converted ? *converted : other;
+  BasicSparseMatrix result(rows_, other.cols_, format_);
+
+  if (format_ == SparseFormat::kCsr) {
+    MultiplyArrays(result.cols_, offsets_, indices_, values_, b.offsets_,
+                   b.indices_, b.values_, result.offsets_, result.indices_,
+                   result.values_);
+  } else {
+    MultiplyArrays(result.rows_, b.offsets_, b.indices_, b.values_, offsets_,
+                   indices_, values_, result.offsets_, result.indices_,
+                   result.values_);
+  }
+
+  return result;
+}
+
+template <typename T>
+BasicMatrix<T> BasicSparseMatrix<T>::operator*(
+    const BasicMatrix<T>& dense) const {
+  if (cols_ != dense.GetRows()) {
+    throw std::invalid_argument(
+        "Num of cols in the first matrix must be equal the num of rows in the "
+        "second matrix");
+  }
+
+  const int k = dense.GetCols();
+  const T* b = dense.data();
+  BasicMatrix<T> result(rows_, k);
+  T* c = result.data();
+  const long work = static_cast<long>(indices_.size()) * k;
+
+  if (format_ == SparseFormat::kCsr) {
+    // Row i of the result combines the rows of B picked out by row i of A.
+    ForEachChunk(offsets_, work, [&](const int begin, const int end) {
+      for (int i = begin; i < end; i++) {
+        T* c_row = c + static_cast<long>(i) * k;
+        for (int p = offsets_[i]; p < offsets_[i + 1]; p++) {
+          const T v = values_[p];
+          const T* b_row = b + static_cast<long>(indices_[p]) * k;
+          for (int j = 0; j < k; j++) c_row[j] += v * b_row[j];
+        }
+      }
+    });
+    return result;
+  }
+
+  // Column j of A scatters row j of B into the result. With enough column
+  // slices of the result to go round, tasks own disjoint slices; otherwise
+  // they take ranges of the columns of A and scatter into private copies.
+  ThreadPool& pool = ThreadPool::Instance();
+  const int slices = (k + kDenseSlice - 1) / kDenseSlice;
+  if (work >= kParallelWork && pool.GetNumThreads() > 1 &&
+      slices >= pool.GetNumThreads()) {
+    pool.ParallelFor(slices, [&](const int s) {
+      const int first = s * kDenseSlice;
+      const int last = std::min(k, first + kDenseSlice);
+      for (int j = 0; j < cols_; j++) {
+        const T* b_row = b + static_cast<long>(j) * k;
+        for (int p = offsets_[j]; p < offsets_[j + 1]; p++) {
+          const T v = values_[p];
+          T* c_row = c + static_cast<long>(indices_[p]) * k;
+          for (int l = first; l < last; l++) c_row[l] += v * b_row[l];
+        }
+      }
+    });
+    return result;
+  }
+
+  ScatterChunks(offsets_, work, static_cast<std::size_t>(rows_) * k, c,
+                [&](const int begin, const int end, T* out) {
+                  for (int j = begin; j < end; j++) {
+                    const T* b_row = b + static_cast<long>(j) * k;
+                    for (int p = offsets_[j]; p < offsets_[j + 1]; p++) {
+                      const T v = values_[p];
+                      T* c_row = out + static_cast<long>(indices_[p]) * k;
+                      for (int l = 0; l < k; l++) c_row[l] += v * b_row[l];
+                    }
+                  }
+                });
+
+  return result;
+}
+
+template <typename T>
+std::vector<T> BasicSparseMatrix<T>::operator*(const std::vector<T>& x) const {
+  if (static_cast<int>(x.size()) != cols_) {
+    throw std::invalid_argument(
+        "Num of cols in the first matrix must be equal the num of rows in the "
+        "second matrix");
+  }
+
+  std::vector<T> y(rows_, T());
+
+  if (format_ == SparseFormat::kCsr) {
+    ForEachChunk(offsets_, static_cast<long>(indices_.size()),
+                 [&](const int begin, const int end) {
+                   for (int i = begin; i < end; i++) {
+                     T sum = T();
+                     for (int p = offsets_[i]; p < offsets_[i + 1]; p++)
+                       sum += values_[p] * x[indices_[p]];
+                     y[i] = sum;
+                   }
+                 });
+  } else {
+    // Columns scatter into shared elements of y; convert to CSR first when
+    // the product is repeated, which saves the private copies of y.
+    ScatterChunks(offsets_, static_cast<long>(indices_.size()), y.size(),
+                  y.data(), [&](const int begin, const int end, T* out) {
+                    for (int j = begin; j < end; j++)
+                      for (int p = offsets_[j]; p < offsets_[j + 1]; p++)
+                        out[indices_[p]] += values_[p] * x[j];
+                  });
+  }
+
+  return y;
+}
+
+template <typename T>
+BasicSparseMatrix<T> BasicSparseMatrix<T>::operator*(const T num) const {
+  if (num == T()) return BasicSparseMatrix(rows_, cols_, format_);
+
+  BasicSparseMatrix result = *this;
+  for (T& value : result.values_) value *= num;
+
+  return result;
+}
+
+template <typename T>
+bool BasicSparseMatrix<T>::operator==(const BasicSparseMatrix& other) const {
+  if (rows_ != other.rows_ || cols_ != other.cols_) return false;
+
+  const BasicSparseMatrix difference = *this - other;
+  for (const T& value : difference.values_)
+    if (std::abs(value) >= kEpsilon<T>) return false;
+
+  return true;
+}
+
+// INSTANTIATIONS
+#define XMATRIX_INSTANTIATE_SPARSE_MATRIX(T) \
+  template class BasicSparseMatrix<T>;
+XMATRIX_FOR_EACH_SCALAR(XMATRIX_INSTANTIATE_SPARSE_MATRIX)
+#undef XMATRIX_INSTANTIATE_SPARSE_MATRIX
+
+}  // namespace xMatrix
@@ -0,0 +1,98 @@
+#ifndef XMATRIX_SPARSE_MATRIX_H
+#define XMATRIX_SPARSE_MATRIX_H
+
+#include <vector>
+
+#include "xmatrix.h"
+
+namespace xMatrix {
+
+// CSR keeps the nonzeros row by row, CSC column by column. Products and sums
+// are fastest in CSR; CSC gives the same for the transpose.
+enum class SparseFormat { kCsr, kCsc };
+
+// Compressed sparse matrix of T. Memory is O(nonzeros + rows) in CSR and
+// O(nonzeros + cols) in CSC, and every operation runs in time proportional to
+// the nonzeros it touches. Within a row (CSR) or column (CSC) the indices are
+// sorted and unique. Compiled for the types in XMATRIX_FOR_EACH_SCALAR;
+// SparseMatrix is the double instantiation.
+template <typename T>
+class BasicSparseMatrix {
+ public:
+  struct Triplet {
+    int row;
+    int col;
+    T value;
+  };
+
+  // An all-zero rows x cols matrix.
+  BasicSparseMatrix(int rows, int cols,
+                    SparseFormat format = SparseFormat::kCsr);
+  // Takes ready compressed arrays: offsets has one entry per row (CSR) or
+  // column (CSC) plus one, and entries offsets[i]..offsets[i + 1] of indices
+  // and values describe row or column i. Throws std::invalid_argument when
+  // the arrays are inconsistent or the indices unsorted.
+  BasicSparseMatrix(int rows, int cols, SparseFormat format,
+                    std::vector<int> offsets, std::vector<int> indices,
+                    std::vector<T> values);
+  // Keeps the nonzero elements of a dense matrix.
+  explicit BasicSparseMatrix(const BasicMatrix<T>& dense,
+                             SparseFormat format = SparseFormat::kCsr);
+
+  // Builds a matrix from (row, col, value) triplets in any order; values of
+  // repeated positions are summed.
+  [[nodiscard]] static BasicSparseMatrix FromTriplets(
+      int rows, int cols, const std::vector<Triplet>& triplets,
+      SparseFormat format = SparseFormat::kCsr);
+
+  [[nodiscard]] int GetRows() const;
+  [[nodiscard]] int GetCols() const;
+  [[nodiscard]] SparseFormat GetFormat() const;
+  [[nodiscard]] int GetNonZeros() const;
+  [[nodiscard]] const std::vector<int>& GetOffsets() const;
+  [[nodiscard]] const std::vector<int>& GetIndices() const;
+  [[nodiscard]] const std::vector<T>& GetValues() const;
+
+  // Element (r, c), zero when it is not stored. O(log nonzeros of the row or
+  // column).
+  [[nodiscard]] T At(int r, int c) const;
+
+  // Same matrix in the given format; converting costs O(nonzeros).
+  [[nodiscard]] BasicSparseMatrix ToFormat(SparseFormat format) const;
+  // The CSR arrays of A are the CSC arrays of A^T and vice versa, so this
+  // copies the arrays as they are and flips the format; nothing is sorted.
+  [[nodiscard]] BasicSparseMatrix Transpose() const;
+  [[nodiscard]] BasicMatrix<T> ToMatrix() const;
+
+  // Element-wise sums in the format of this matrix; entries that cancel to
+  // zero are dropped.
+  BasicSparseMatrix operator+(const BasicSparseMatrix& other) const;
+  BasicSparseMatrix operator-(const BasicSparseMatrix& other) const;
+  // Sparse product in the format of this matrix. Rows (CSR) or columns (CSC)
+  // of the result are computed in parallel.
+  BasicSparseMatrix operator*(const BasicSparseMatrix& other) const;
+  // Sparse times dense and, below, sparse times vector, split across the
+  // thread pool for large products. In CSC the columns of A scatter into the
+  // result, so threads short of other work add into private copies of it
+  // that are summed at the end: up to one result-sized buffer per thread.
+  BasicMatrix<T> operator*(const BasicMatrix<T>& dense) const;
+  // y = A * x for a vector of GetCols() elements.
+  std::vector<T> operator*(const std::vector<T>& x) const;
+  BasicSparseMatrix operator*(T num) const;
+  bool operator==(const BasicSparseMatrix& other) const;
+
+ private:
+  // Rows in CSR, columns in CSC.
+  [[nodiscard]] int MajorSize() const;
+
+  int rows_, cols_;
+  SparseFormat format_;
+  std::vector<int> offsets_;
+  std::vector<int> indices_;
+  std::vector<T> values_;
+};
+
+using SparseMatrix = BasicSparseMatrix<double>;
+
+}  // namespace xMatrix
+#endif  // XMATRIX_SPARSE_MATRIX_H
@@ -0,0 +1,210 @@
+#include "text_io.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <system_error>
+#include <vector>
+
+namespace xMatrix {
+
+namespace {
+
+// Text is produced and consumed in blocks of this size.
+constexpr std::size_t kBufferSize = std::size_t{1} << 16;
+// Room for the longest shortest-form number of any supported type (long
+// double needs about 30 characters) plus its delimiter.
+constexpr std::size_t kMaxFieldChars = 64;
+
+bool IsBlank(const char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+template <typename T, typename Flush>
+void Format(const BasicMatrix<T>& m, const char delimiter, const Flush& flush) {
+  char buffer[kBufferSize];
+  char* p = buffer;
+  const int rows = m.GetRows(), cols = m.GetCols();
+
+  for (int i = 0; i < rows; i++) {
+    const T* row = m.RowPtr(i);
+    for (int j = 0; j < cols; j++) {
+      if (p + kMaxFieldChars > buffer + kBufferSize) {
+        flush(buffer, p - buffer);
+        p = buffer;
+      }
+      p = std::to_chars(p, p + kMaxFieldChars - 1, row[j]).ptr;
+      *p++ = j + 1 < cols ? delimiter : '\n';
+    }
+  }
+
+  flush(buffer, p - buffer);
+}
+
+// Appends the fields of the line [first, last) to values and returns how many
+// there were. Fields are separated by blanks and, when it is not a blank
+// itself, one delimiter.
+template <typename T>
+int ParseLine(const char* p, const char* const last, const char delimiter,
+              std::vector<T>& values) {
+  int count = 0;
+
+  while (true) {
+    while (p != last && IsBlank(*p)) p++;
+    if (p == last) return count;
+
+    if (count > 0 && *p == delimiter) {
+      p++;
+      while (p != last && IsBlank(*p)) p++;
+    }
+
+    // from_chars takes no leading '+', which other writers emit. Skipping it
+    // must not let a second sign through.
+    if (p != last && *p == '+') {
+      p++;
+      if (p != last && *p == '-') {
+        throw std::invalid_argument("Cannot parse a number");
+      }
+    }
+
+    T value;
+    const std::from_chars_result result = std::from_chars(p, last, value);
+    if (result.ec == std::errc::result_out_of_range) {
+      throw std::invalid_argument("Number is out of range");
+    }
+    if (result.ec != std::errc() ||
+        (result.ptr != last && !IsBlank(*result.ptr) &&
+         *result.ptr != delimiter)) {
+      throw std::invalid_argument("Cannot parse a number");
+    }
+
+    values.push_back(value);
+    count++;
+    p = result.ptr;
+  }
+}
+
+// Reads blocks through read(data, size), which returns 0 at the end of the
+// input, and parses every complete line as soon as it has arrived.
+template <typename T, typename Read>
+BasicMatrix<T> Parse(const char delimiter, const Read& read) {
+  std::vector<char> buffer(kBufferSize);
+  std::size_t filled = 0;
+  std::vector<T> values;
+  int rows = 0, cols = 0;
+
+  for (bool done = false; !done;) {
+    // A line longer than the buffer needs a bigger one.
+    if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+
+    const std::size_t n = read(buffer.data() + filled, buffer.size() - filled);
+    done = n == 0;
+    filled += n;
+
+    const char* const begin = buffer.data();
+    const char* const end = begin + filled;
+    const char* line = begin;
+
+    while (line != end) {
+      const char* newline = static_cast<const char*>(
+          std::memchr(line, '\n', static_cast<std::size_t>(end - line)));
+      if (newline == nullptr && !done) break;
+      const char* const line_end = newline == nullptr ? end : newline;
+
+      const int count = ParseLine(line, line_end, delimiter, values);
+      if (count > 0) {
+        if (rows > 0 && count != cols) {
+          throw std::invalid_argument("Rows have different lengths");
+        }
+        cols = count;
+        rows++;
+      }
+
+      line = newline == nullptr ? end : newline + 1;
+    }
+
+    filled = static_cast<std::size_t>(end - line);
+    std::memmove(buffer.data(), line, filled);
+  }
+
+  if (rows == 0) {
+    throw std::invalid_argument("Text contains no matrix rows");
+  }
+
+  BasicMatrix<T> result(rows, cols);
+  std::copy(values.begin(), values.end(), result.begin());
+
+  return result;
+}
+
+}  // namespace
+
+template <typename T>
+void WriteText(const BasicMatrix<T>& m, std::ostream& out,
+               const TextOptions& options) {
+  Format(m, options.delimiter, [&out](const char* data, const long size) {
+    out.write(data, size);
+  });
+}
+
+template <typename T>
+void WriteText(const BasicMatrix<T>& m, const int fd,
+               const TextOptions& options) {
+  Format(m, options.delimiter, [fd](const char* data, long size) {
+    while (size > 0) {
+      const ssize_t written = ::write(fd, data, static_cast<size_t>(size));
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        throw std::system_error(errno, std::generic_category(),
+                                "Cannot write matrix text");
+      }
+      data += written;
+      size -= written;
+    }
+  });
+}
+
+template <typename T>
+BasicMatrix<T> ReadText(std::istream& in, const TextOptions& options) {
+  return Parse<T>(options.delimiter,
+                  [&in](char* data, const std::size_t size) {
+                    in.read(data, static_cast<std::streamsize>(size));
+                    return static_cast<std::size_t>(in.gcount());
+                  });
+}
+
+template <typename T>
+BasicMatrix<T> ReadText(const int fd, const TextOptions& options) {
+  return Parse<T>(options.delimiter,
+                  [fd](char* data, const std::size_t size) -> std::size_t {
+                    while (true) {
+                      const ssize_t n = ::read(fd, data, size);
+                      if (n >= 0) return static_cast<std::size_t>(n);
+                      if (errno != EINTR) {
+                        throw std::system_error(errno, std::generic_category(),
+                                                "Cannot read matrix text");
+                      }
+                    }
+                  });
+}
+
+// INSTANTIATIONS
+// std::to_chars and std::from_chars have no complex overloads, so text I/O
+// covers the real element types only.
+#define XMATRIX_INSTANTIATE_TEXT_IO(T)                                      \
+  template void WriteText(const BasicMatrix<T>& m, std::ostream& out,       \
+                          const TextOptions& options);                      \
+  template void WriteText(const BasicMatrix<T>& m, int fd,                  \
+                          const TextOptions& options);                      \
+  template BasicMatrix<T> ReadText(std::istream& in,                        \
+                                   const TextOptions& options);             \
+  template BasicMatrix<T> ReadText(int fd, const TextOptions& options);
+XMATRIX_INSTANTIATE_TEXT_IO(float)
+XMATRIX_INSTANTIATE_TEXT_IO(double)
+XMATRIX_INSTANTIATE_TEXT_IO(long double)
+#undef XMATRIX_INSTANTIATE_TEXT_IO
+
+}  // namespace xMatrix
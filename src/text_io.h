@@ -0,0 +1,40 @@
+#ifndef XMATRIX_TEXT_IO_H
+#define XMATRIX_TEXT_IO_H
+
+#include <iosfwd>
+
+#include "xmatrix.h"
+
+namespace xMatrix {
+
+struct TextOptions {
+  // Written between the elements of a row. Readers always accept spaces and
+  // tabs as well, so ',' reads both CSV and whitespace-separated text.
+  char delimiter = ' ';
+};
+
+// Writes one line per row, with each element in the shortest form that reads
+// back to the same value (std::to_chars), so WriteText and ReadText round-trip
+// exactly. Output is assembled in a local buffer and handed to the stream or
+// descriptor in large blocks. Compiled for float, double and long double.
+// Throws std::system_error when a descriptor write fails.
+template <typename T>
+void WriteText(const BasicMatrix<T>& m, std::ostream& out,
+               const TextOptions& options = {});
+template <typename T>
+void WriteText(const BasicMatrix<T>& m, int fd,
+               const TextOptions& options = {});
+
+// Parses text written by WriteText, a CSV file or any other table of numbers
+// with one row per line; blank lines are skipped and "\r\n" line ends are
+// accepted. Throws std::invalid_argument when a field is not a number, the
+// rows differ in length or there are no rows at all, and std::system_error
+// when a descriptor read fails.
+template <typename T = double>
+[[nodiscard]] BasicMatrix<T> ReadText(std::istream& in,
+                                      const TextOptions& options = {});
+template <typename T = double>
+[[nodiscard]] BasicMatrix<T> ReadText(int fd, const TextOptions& options = {});
+
+}  // namespace xMatrix
+#endif  // XMATRIX_TEXT_IO_H
@@ -0,0 +1,136 @@
+#include "thread_pool.h"
+
+#include <cstdlib>
+#include <stdexcept>
+
+namespace xMatrix {
+namespace internal {
+
+namespace {
+
+thread_local bool in_parallel_region = false;
+
+int DefaultNumThreads() {
+  if (const char* env = std::getenv("XMATRIX_NUM_THREADS")) {
+    const int n = std::atoi(env);
+    if (n > 0) return n;
+  }
+
+  const unsigned hardware = std::thread::hardware_concurrency();
+  return hardware > 0 ? static_cast<int>(hardware) : 1;
+}
+
+}  // namespace
+
+ThreadPool& ThreadPool::Instance() {
+  static ThreadPool pool;
+  return pool;
+}
+
+ThreadPool::ThreadPool() : num_threads_(DefaultNumThreads()) {}
+
+ThreadPool::~ThreadPool() { StopWorkers(); }
+
+int ThreadPool::GetNumThreads() const { return num_threads_; }
+
+void ThreadPool::SetNumThreads(const int n) {
+  if (n < 1) {
+    throw std::invalid_argument("Number of threads must be positive");
+  }
+
+  std::lock_guard<std::mutex> run_lock(run_mutex_);
+  StopWorkers();
+  num_threads_ = n;
+}
+
+void ThreadPool::ParallelFor(const int count,
+                             const std::function<void(int)>& body) {
+  std::unique_lock<std::mutex> run_lock(run_mutex_, std::defer_lock);
+
+  if (count <= 1 || num_threads_ == 1 || in_parallel_region ||
+      !run_lock.try_lock()) {
+    for (int i = 0; i < count; i++) body(i);
+    return;
+  }
+
+  if (workers_.empty()) StartWorkers();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    body_ = &body;
+    count_ = count;
+    next_ = 0;
+    error_ = nullptr;
+    active_ = static_cast<int>(workers_.size());
+    generation_++;
+  }
+  wake_.notify_all();
+
+  in_parallel_region = true;
+  RunTasks();
+  in_parallel_region = false;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return active_ == 0; });
+  body_ = nullptr;
+
+  if (error_) std::rethrow_exception(error_);
+}
+
+void ThreadPool::StartWorkers() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stop_ = false;
+  for (int i = 1; i < num_threads_; i++)
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this, generation_);
+}
+
+void ThreadPool::StopWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+
+  for (std::thread& worker : workers_) worker.join();
+  workers_.clear();
+}
+
+void ThreadPool::WorkerLoop(unsigned long seen) {
+  in_parallel_region = true;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) return;
+      seen = generation_;
+    }
+
+    RunTasks();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--active_ == 0) done_.notify_one();
+  }
+}
+
+void ThreadPool::RunTasks() {
+  while (true) {
+    int i;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (next_ >= count_) return;
+      i = next_++;
+    }
+
+    try {
+      (*body_)(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_) error_ = std::current_exception();
+      next_ = count_;
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace xMatrix
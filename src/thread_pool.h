@@ -0,0 +1,60 @@
+#ifndef XMATRIX_THREAD_POOL_H
+#define XMATRIX_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xMatrix {
+namespace internal {
+
+// Persistent pool shared by every parallel kernel of the library. The calling
+// thread takes part in the work, so a pool of N threads keeps N - 1 workers.
+class ThreadPool {
+ public:
+  static ThreadPool& Instance();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ~ThreadPool();
+
+  [[nodiscard]] int GetNumThreads() const;
+  void SetNumThreads(int n);
+
+  // Calls body(i) for every i in [0, count) and returns once all are done.
+  // Nested or concurrent calls run serially on the calling thread.
+  void ParallelFor(int count, const std::function<void(int)>& body);
+
+ private:
+  ThreadPool();
+
+  void StartWorkers();
+  void StopWorkers();
+  void WorkerLoop(unsigned long seen);
+  void RunTasks();
+
+  // Written by SetNumThreads() under run_mutex_, read without it.
+  std::atomic<int> num_threads_;
+  std::vector<std::thread> workers_;
+
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  unsigned long generation_ = 0;
+  bool stop_ = false;
+  int active_ = 0;
+
+  const std::function<void(int)>* body_ = nullptr;
+  int count_ = 0;
+  int next_ = 0;
+  std::exception_ptr error_;
+};
+
+}  // namespace internal
+}  // namespace xMatrix
+#endif  // XMATRIX_THREAD_POOL_H
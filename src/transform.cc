@@ -0,0 +1,214 @@
+#include "transform.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace xMatrix {
+
+namespace {
+
+// Points are processed in chunks with a constant trip count. Inside a chunk
+// the points are independent, which lets the compiler vectorize the loop for
+// each target it is built for. That holds for an exactly in-place transform,
+// where point i is read and then overwritten by iteration i alone, but not
+// for output that overlaps the input at an offset; transform.h rules it out.
+constexpr size_t kChunk = 64;
+
+// Batches below this size are not worth waking the thread pool for.
+constexpr size_t kParallelPoints = size_t{1} << 16;
+constexpr size_t kPointsPerTask = size_t{1} << 14;
+
+// Coordinate streams; the stride (3 or 4 for AoS, 1 for SoA) and whether w is
+// read or written are template parameters of the kernels, which keeps their
+// loop bodies branch-free.
+template <typename T>
+struct PointStreams {
+  T* x;
+  T* y;
+  T* z;
+  T* w;
+};
+
+template <size_t Stride, bool InW, bool OutW, bool Divide, typename T>
+#if defined(__GNUC__)
+__attribute__((always_inline))
+#endif
+inline void TransformPoint(const T* c, const PointStreams<const T>& in,
+                           const PointStreams<T>& out, const size_t i) {
+  // Every coordinate is read before any is written, so in-place transforms
+  // are safe.
+  const size_t at = i * Stride;
+  const T x = in.x[at], y = in.y[at], z = in.z[at];
+  const T w = InW ? in.w[at] : T(1);
+
+  T tx = c[0] * x + c[1] * y + c[2] * z + c[3] * w;
+  T ty = c[4] * x + c[5] * y + c[6] * z + c[7] * w;
+  T tz = c[8] * x + c[9] * y + c[10] * z + c[11] * w;
+  const T tw = c[12] * x + c[13] * y + c[14] * z + c[15] * w;
+
+  if (Divide) {
+    const T inv_w = T(1) / tw;
+    tx *= inv_w;
+    ty *= inv_w;
+    tz *= inv_w;
+  }
+
+  out.x[at] = tx;
+  out.y[at] = ty;
+  out.z[at] = tz;
+  if (OutW) out.w[at] = tw;
+}
+
+template <size_t Stride, bool InW, bool OutW, bool Divide, typename T>
+#if defined(__GNUC__)
+__attribute__((always_inline))
+#endif
+inline void TransformRangeImpl(const T* c, const PointStreams<const T>& in,
+                               const PointStreams<T>& out, size_t first,
+                               const size_t last) {
+  for (; first + kChunk <= last; first += kChunk) {
+    // Sound only for the aliasing allowed by transform.h, see kChunk.
+#if defined(__GNUC__)
+#pragma GCC ivdep
+#endif
+    for (size_t i = first; i < first + kChunk; i++)
+      TransformPoint<Stride, InW, OutW, Divide>(c, in, out, i);
+  }
+
+  for (; first < last; first++)
+    TransformPoint<Stride, InW, OutW, Divide>(c, in, out, first);
+}
+
+template <size_t Stride, bool InW, bool OutW, bool Divide, typename T>
+void TransformRangeDefault(const T* c, const PointStreams<const T>& in,
+                           const PointStreams<T>& out, const size_t first,
+                           const size_t last) {
+  TransformRangeImpl<Stride, InW, OutW, Divide>(c, in, out, first, last);
+}
+
+#if defined(XMATRIX_X86_DISPATCH)
+template <size_t Stride, bool InW, bool OutW, bool Divide, typename T>
+__attribute__((target("avx2,fma"))) void TransformRangeAvx2(
+    const T* c, const PointStreams<const T>& in, const PointStreams<T>& out,
+    const size_t first, const size_t last) {
+  TransformRangeImpl<Stride, InW, OutW, Divide>(c, in, out, first, last);
+}
+
+template <size_t Stride, bool InW, bool OutW, bool Divide, typename T>
+__attribute__((target("avx512f"))) void TransformRangeAvx512(
+    const T* c, const PointStreams<const T>& in, const PointStreams<T>& out,
+    const size_t first, const size_t last) {
+  TransformRangeImpl<Stride, InW, OutW, Divide>(c, in, out, first, last);
+}
+#endif
+
+template <typename T>
+using TransformRangeFn = void (*)(const T*, const PointStreams<const T>&,
+                                  const PointStreams<T>&, size_t, size_t);
+
+template <size_t Stride, bool InW, bool OutW, bool Divide, typename T>
+TransformRangeFn<T> SelectTransformRange() {
+#if defined(XMATRIX_X86_DISPATCH)
+  switch (internal::GetSimdLevel()) {
+    case internal::SimdLevel::kAvx512:
+      return TransformRangeAvx512<Stride, InW, OutW, Divide, T>;
+    case internal::SimdLevel::kAvx2:
+      return TransformRangeAvx2<Stride, InW, OutW, Divide, T>;
+    default:
+      break;
+  }
+#endif
+  return TransformRangeDefault<Stride, InW, OutW, Divide, T>;
+}
+
+template <size_t Stride, bool InW, bool OutW, typename T>
+void TransformStreams(const Matrix& m, const PointStreams<const T>& in,
+                      const size_t n, const PointStreams<T>& out,
+                      const TransformOptions& options) {
+  if (m.GetRows() != 4 || m.GetCols() != 4) {
+    throw std::invalid_argument("Transform matrix must be 4x4");
+  }
+
+  static const TransformRangeFn<T> transform =
+      SelectTransformRange<Stride, InW, OutW, false, T>();
+  static const TransformRangeFn<T> transform_divide =
+      SelectTransformRange<Stride, InW, OutW, true, T>();
+  const TransformRangeFn<T> range =
+      options.perspective_divide ? transform_divide : transform;
+
+  T c[16];
+  std::transform(m.begin(), m.end(), c,
+                 [](const double x) { return static_cast<T>(x); });
+
+  if (!options.parallel || n < kParallelPoints) {
+    range(c, in, out, 0, n);
+    return;
+  }
+
+  const int tasks = static_cast<int>((n + kPointsPerTask - 1) / kPointsPerTask);
+  internal::ThreadPool::Instance().ParallelFor(tasks, [&](const int task) {
+    const size_t first = task * kPointsPerTask;
+    range(c, in, out, first, std::min(n, first + kPointsPerTask));
+  });
+}
+
+template <typename T>
+void TransformInterleaved(const Matrix& m, const T* in, const size_t n,
+                          T* out, const TransformOptions& options) {
+  if (options.layout == PointLayout::kXYZW) {
+    TransformStreams<4, true, true, T>(m, {in, in + 1, in + 2, in + 3}, n,
+                                       {out, out + 1, out + 2, out + 3},
+                                       options);
+  } else {
+    TransformStreams<3, false, false, T>(m, {in, in + 1, in + 2, nullptr}, n,
+                                         {out, out + 1, out + 2, nullptr},
+                                         options);
+  }
+}
+
+template <typename T>
+void TransformSeparate(const Matrix& m, const SoAPoints<const T>& in,
+                       const size_t n, const SoAPoints<T>& out,
+                       const TransformOptions& options) {
+  const PointStreams<const T> source{in.x, in.y, in.z, in.w};
+  const PointStreams<T> sink{out.x, out.y, out.z, out.w};
+
+  if (in.w != nullptr && out.w != nullptr) {
+    TransformStreams<1, true, true>(m, source, n, sink, options);
+  } else if (in.w != nullptr) {
+    TransformStreams<1, true, false>(m, source, n, sink, options);
+  } else if (out.w != nullptr) {
+    TransformStreams<1, false, true>(m, source, n, sink, options);
+  } else {
+    TransformStreams<1, false, false>(m, source, n, sink, options);
+  }
+}
+
+}  // namespace
+
+void TransformPoints(const Matrix& m, const float* in, const size_t n,
+                     float* out, const TransformOptions& options) {
+  TransformInterleaved(m, in, n, out, options);
+}
+
+void TransformPoints(const Matrix& m, const double* in, const size_t n,
+                     double* out, const TransformOptions& options) {
+  TransformInterleaved(m, in, n, out, options);
+}
+
+void TransformPoints(const Matrix& m, const SoAPoints<const float>& in,
+                     const size_t n, const SoAPoints<float>& out,
+                     const TransformOptions& options) {
+  TransformSeparate(m, in, n, out, options);
+}
+
+void TransformPoints(const Matrix& m, const SoAPoints<const double>& in,
+                     const size_t n, const SoAPoints<double>& out,
+                     const TransformOptions& options) {
+  TransformSeparate(m, in, n, out, options);
+}
+
+}  // namespace xMatrix
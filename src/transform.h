@@ -0,0 +1,49 @@
+#ifndef XMATRIX_TRANSFORM_H
+#define XMATRIX_TRANSFORM_H
+
+#include <cstddef>
+
+#include "xmatrix.h"
+
+namespace xMatrix {
+
+// Interleaved (array of structures) point layouts. XYZ points get an implicit
+// w = 1; XYZW points carry their own w.
+enum class PointLayout { kXYZ, kXYZW };
+
+struct TransformOptions {
+  PointLayout layout = PointLayout::kXYZ;
+  // Divide x, y and z by the transformed w. XYZW outputs keep the w before
+  // the divide.
+  bool perspective_divide = false;
+  // Split large batches across the library thread pool.
+  bool parallel = true;
+};
+
+// Separate coordinate arrays (structure of arrays). A null w means w = 1 on
+// input and is not written on output.
+template <typename T>
+struct SoAPoints {
+  T* x;
+  T* y;
+  T* z;
+  T* w = nullptr;
+};
+
+// Applies the 4x4 matrix m to n points: out = m * (x, y, z, w)^T. The points
+// may be transformed in place, with out == in (for SoAPoints, each output
+// stream equal to the matching input stream); otherwise output and input
+// must not overlap at all. Throws std::invalid_argument when m is not 4x4.
+void TransformPoints(const Matrix& m, const float* in, size_t n, float* out,
+                     const TransformOptions& options = {});
+void TransformPoints(const Matrix& m, const double* in, size_t n, double* out,
+                     const TransformOptions& options = {});
+void TransformPoints(const Matrix& m, const SoAPoints<const float>& in,
+                     size_t n, const SoAPoints<float>& out,
+                     const TransformOptions& options = {});
+void TransformPoints(const Matrix& m, const SoAPoints<const double>& in,
+                     size_t n, const SoAPoints<double>& out,
+                     const TransformOptions& options = {});
+
+}  // namespace xMatrix
+#endif  // XMATRIX_TRANSFORM_H
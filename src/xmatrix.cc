@@ -1,67 +1,252 @@
 #include "xmatrix.h"
 
+#include <algorithm>
 #include <cmath>
-#include <fstream>
 #include <iostream>
+#include <limits>
+#include <utility>
+
+#include "gemm.h"
+#include "instrumentation.h"
+#include "simd.h"
+#include "thread_pool.h"
 
 namespace xMatrix {
 
 namespace {
 
-Matrix::MatrixType CreateMatrix(const int r, const int c) {
+template <typename T>
+typename BasicMatrix<T>::MatrixType CreateMatrix(
+    const int r, const int c,
+    const AlignedAllocator<T>& allocator = AlignedAllocator<T>()) {
   if (r < 1 || c < 1) {
     throw std::invalid_argument(
         "Input arguments must be positive and not equal to zero");
   }
 
-  return Matrix::MatrixType(r * c, 0.0);
+  return typename BasicMatrix<T>::MatrixType(r * c, T(), allocator);
+}
+
+// Factors the n x n row-major matrix m in place into the packed L and U of
+// P * A = L * U with partial pivoting. perm, when given, receives the row
+// order; sign receives the sign of the permutation. Returns true when the
+// matrix is singular: a column has no nonzero pivot, or its pivot is what is
+// left after the elimination cancelled terms of much larger magnitude, i.e.
+// zero up to rounding. A pivot that is merely small, like the 1e-17 of
+// diag(1e-17, 1, 1), is kept whatever the scale of the other entries, so the
+// determinant is the product of the pivots and ill-conditioning is left to
+// ReciprocalCondition().
+template <typename T>
+bool FactorLU(T* m, const int n, int* perm, int& sign) {
+  using Real = internal::RealType<T>;
+  const Real rounding = n * std::numeric_limits<Real>::epsilon();
+
+  bool singular = false;
+  sign = 1;
+  if (perm != nullptr)
+    for (int i = 0; i < n; i++) perm[i] = i;
+
+  for (int k = 0; k < n; k++) {
+    int pivot = k;
+    Real max_value = std::abs(m[k * n + k]);
+    for (int i = k + 1; i < n; i++) {
+      const Real value = std::abs(m[i * n + k]);
+      if (value > max_value) {
+        max_value = value;
+        pivot = i;
+      }
+    }
+
+    // The pivot is a(pivot, k) minus l(pivot, t) * u(t, k) for every earlier
+    // step t; rounding in those updates is bounded by this sum.
+    Real cancelled = 0;
+    for (int t = 0; t < k; t++)
+      cancelled += std::abs(m[pivot * n + t]) * std::abs(m[t * n + k]);
+
+    if (max_value == Real(0) || max_value <= rounding * cancelled) {
+      singular = true;
+      continue;
+    }
+
+    if (pivot != k) {
+      std::swap_ranges(m + k * n, m + (k + 1) * n, m + pivot * n);
+      if (perm != nullptr) std::swap(perm[k], perm[pivot]);
+      sign = -sign;
+    }
+
+    const T* pivot_row = m + k * n;
+    for (int i = k + 1; i < n; i++) {
+      T* row = m + i * n;
+      const T factor = row[k] / pivot_row[k];
+      row[k] = factor;
+      for (int j = k + 1; j < n; j++) row[j] -= factor * pivot_row[j];
+    }
+  }
+
+  return singular;
+}
+
+// Overwrites the permuted n x cols row-major block b with U^-1 * L^-1 * b,
+// where lu holds the packed factors from FactorLU().
+template <typename T>
+void SubstituteLU(const T* lu, const int n, T* b, const int cols) {
+  for (int i = 1; i < n; i++) {
+    T* row = b + i * cols;
+    for (int k = 0; k < i; k++) {
+      const T factor = lu[i * n + k];
+      const T* source = b + k * cols;
+      for (int j = 0; j < cols; j++) row[j] -= factor * source[j];
+    }
+  }
+
+  for (int i = n - 1; i >= 0; i--) {
+    T* row = b + i * cols;
+    for (int k = i + 1; k < n; k++) {
+      const T factor = lu[i * n + k];
+      const T* source = b + k * cols;
+      for (int j = 0; j < cols; j++) row[j] -= factor * source[j];
+    }
+    const T pivot = lu[i * n + i];
+    for (int j = 0; j < cols; j++) row[j] /= pivot;
+  }
 }
 
 }  // namespace
 
+void SetNumThreads(const int n) {
+  internal::ThreadPool::Instance().SetNumThreads(n);
+}
+
+int GetNumThreads() { return internal::ThreadPool::Instance().GetNumThreads(); }
+
 // CONSTRUCTORS & DESTRUCTORS
-Matrix::Matrix() : rows_(3), cols_(3) { matrix_ = CreateMatrix(rows_, cols_); }
+template <typename T>
+BasicMatrix<T>::BasicMatrix() : rows_(3), cols_(3) {
+  XMATRIX_INSTRUMENT(kConstruct, 0);
+  matrix_ = CreateMatrix<T>(rows_, cols_);
+}
 
-Matrix::Matrix(const int rows, const int cols) : rows_(rows), cols_(cols) {
-  matrix_ = CreateMatrix(rows, cols);
+template <typename T>
+BasicMatrix<T>::BasicMatrix(const int rows, const int cols)
+    : rows_(rows), cols_(cols) {
+  XMATRIX_INSTRUMENT(kConstruct, 0);
+  matrix_ = CreateMatrix<T>(rows, cols);
 }
 
-Matrix::Matrix(const Matrix& o) : rows_(o.rows_), cols_(o.cols_) {
-  matrix_ = CreateMatrix(o.rows_, o.cols_);
+template <typename T>
+BasicMatrix<T>::BasicMatrix(const int rows, const int cols,
+                            std::pmr::memory_resource* resource)
+    : rows_(rows), cols_(cols) {
+  XMATRIX_INSTRUMENT(kConstruct, 0);
+  matrix_ = CreateMatrix<T>(rows, cols, AlignedAllocator<T>(resource));
+}
 
-  if (!matrix_.empty()) {
-    for (int i = 0; i < o.rows_; i++) {
-      for (int j = 0; j < o.cols_; j++) {
-        matrix_[i * cols_ + j] = o.matrix_[i * o.cols_ + j];
-      }
-    }
-  } else {
+template <typename T>
+BasicMatrix<T>::BasicMatrix(const BasicMatrix& o)
+    : rows_(o.rows_), cols_(o.cols_) {
+  XMATRIX_INSTRUMENT(kCopy, 0);
+  matrix_ = o.matrix_;
+  if (matrix_.empty()) {
     throw std::invalid_argument("The input matrix is incorrect size");
   }
 }
 
-Matrix::Matrix(Matrix&& o) noexcept : rows_(o.rows_), cols_(o.cols_) {
+template <typename T>
+BasicMatrix<T>::BasicMatrix(BasicMatrix&& o) noexcept
+    : rows_(o.rows_), cols_(o.cols_) {
+  XMATRIX_INSTRUMENT(kMove, 0);
   matrix_ = std::move(o.matrix_);
   o.rows_ = 0;
   o.cols_ = 0;
 }
 
-Matrix::~Matrix() {}
+template <typename T>
+BasicMatrix<T>::BasicMatrix(const BasicMatrixView<const T> view)
+    : rows_(view.GetRows()), cols_(view.GetCols()) {
+  XMATRIX_INSTRUMENT(kConstruct, 0);
+  matrix_ = CreateMatrix<T>(rows_, cols_);
+  CopyMatrix(view, *this);
+}
+
+template <typename T>
+BasicMatrix<T>::~BasicMatrix() {}
 
 // ACCESSORS
-int Matrix::GetRows() const { return rows_; }
+template <typename T>
+int BasicMatrix<T>::GetRows() const { return rows_; }
 
-int Matrix::GetCols() const { return cols_; }
+template <typename T>
+int BasicMatrix<T>::GetCols() const { return cols_; }
+
+template <typename T>
+std::pmr::memory_resource* BasicMatrix<T>::GetResource() const {
+  return matrix_.get_allocator().GetResource();
+}
+
+// VIEWS
+template <typename T>
+BasicMatrixView<T> BasicMatrix<T>::Block(const int r, const int c, const int h,
+                                         const int w) {
+  return BasicMatrixView<T>(*this).Block(r, c, h, w);
+}
+
+template <typename T>
+BasicMatrixView<const T> BasicMatrix<T>::Block(const int r, const int c,
+                                               const int h, const int w) const {
+  return BasicMatrixView<const T>(*this).Block(r, c, h, w);
+}
+
+template <typename T>
+BasicMatrixView<T> BasicMatrix<T>::Row(const int i) {
+  return BasicMatrixView<T>(*this).Row(i);
+}
+
+template <typename T>
+BasicMatrixView<const T> BasicMatrix<T>::Row(const int i) const {
+  return BasicMatrixView<const T>(*this).Row(i);
+}
+
+template <typename T>
+BasicMatrixView<T> BasicMatrix<T>::Col(const int j) {
+  return BasicMatrixView<T>(*this).Col(j);
+}
+
+template <typename T>
+BasicMatrixView<const T> BasicMatrix<T>::Col(const int j) const {
+  return BasicMatrixView<const T>(*this).Col(j);
+}
+
+template <typename T>
+BasicMatrixView<T> BasicMatrix<T>::TransposeView() {
+  return BasicMatrixView<T>(*this).Transpose();
+}
+
+template <typename T>
+BasicMatrixView<const T> BasicMatrix<T>::TransposeView() const {
+  return BasicMatrixView<const T>(*this).Transpose();
+}
+
+template <typename T>
+BasicMatrix<T>::operator BasicMatrixView<T>() {
+  return {matrix_.data(), rows_, cols_, cols_};
+}
+
+template <typename T>
+BasicMatrix<T>::operator BasicMatrixView<const T>() const {
+  return {matrix_.data(), rows_, cols_, cols_};
+}
 
 // MUTATORS
-void Matrix::SetRows(const int r) {
+template <typename T>
+void BasicMatrix<T>::SetRows(const int r) {
+  XMATRIX_INSTRUMENT(kResize, 0);
   if (r < 1) {
     throw std::invalid_argument("Rows must be a positive integer");
   }
 
   if (r == rows_) return;
 
-  MatrixType new_matrix = CreateMatrix(r, cols_);
+  MatrixType new_matrix = CreateMatrix<T>(r, cols_, matrix_.get_allocator());
 
   for (int i = 0; i < std::min(r, rows_); i++)
     for (int j = 0; j < cols_; j++)
@@ -71,14 +256,16 @@ void Matrix::SetRows(const int r) {
   rows_ = r;
 }
 
-void Matrix::SetCols(const int c) {
+template <typename T>
+void BasicMatrix<T>::SetCols(const int c) {
+  XMATRIX_INSTRUMENT(kResize, 0);
   if (c < 1) {
     throw std::invalid_argument("Cols must be a positive integer");
   }
 
   if (c == cols_) return;
 
-  MatrixType new_matrix = CreateMatrix(rows_, c);
+  MatrixType new_matrix = CreateMatrix<T>(rows_, c, matrix_.get_allocator());
 
   for (int i = 0; i < rows_; i++)
     for (int j = 0; j < std::min(c, cols_); j++)
@@ -88,10 +275,12 @@ void Matrix::SetCols(const int c) {
   cols_ = c;
 }
 
-void Matrix::Resize(const int r, const int c) {
+template <typename T>
+void BasicMatrix<T>::Resize(const int r, const int c) {
+  XMATRIX_INSTRUMENT(kResize, 0);
   if (r == rows_ && c == cols_) return;
 
-  MatrixType new_matrix = CreateMatrix(r, c);
+  MatrixType new_matrix = CreateMatrix<T>(r, c, matrix_.get_allocator());
 
   if (!new_matrix.empty())
     for (int i = 0; i < std::min(r, rows_); i++)
@@ -104,82 +293,124 @@ void Matrix::Resize(const int r, const int c) {
 }
 
 // MATRIX FUNCTIONS
-bool Matrix::IsEqual(const Matrix& other) const {
+template <typename T>
+bool BasicMatrix<T>::IsEqual(const BasicMatrix& other) const {
+  XMATRIX_INSTRUMENT(kIsEqual, matrix_.size());
   if (rows_ != other.rows_ || cols_ != other.cols_) return false;
 
-  for (int i = 0; i < rows_; i++)
-    for (int j = 0; j < cols_; j++)
-      if (fabs(matrix_[i * cols_ + j] - other.matrix_[i * cols_ + j]) >= EPS)
-        return false;
-
-  return true;
+  return internal::EqualWithin(matrix_.data(), other.matrix_.data(),
+                               matrix_.size(), kEpsilon<T>);
 }
 
-void Matrix::SumMatrix(const Matrix& other) {
+template <typename T>
+void BasicMatrix<T>::SumMatrix(const BasicMatrix& other) {
+  XMATRIX_INSTRUMENT(kSumMatrix, matrix_.size());
   if (rows_ != other.rows_ || cols_ != other.cols_) {
     throw std::invalid_argument("Matrices are not of the same size");
   }
 
-  for (int i = 0; i < rows_; i++)
-    for (int j = 0; j < cols_; j++)
-      matrix_[i * cols_ + j] += other.matrix_[i * cols_ + j];
+  internal::Add(matrix_.data(), other.matrix_.data(), matrix_.size());
 }
 
-void Matrix::SubMatrix(const Matrix& other) {
+template <typename T>
+void BasicMatrix<T>::SubMatrix(const BasicMatrix& other) {
+  XMATRIX_INSTRUMENT(kSubMatrix, matrix_.size());
   if (rows_ != other.rows_ || cols_ != other.cols_) {
     throw std::invalid_argument("Matrices are not of the same size");
   }
 
-  for (int i = 0; i < rows_; i++)
-    for (int j = 0; j < cols_; j++)
-      matrix_[i * cols_ + j] -= other.matrix_[i * cols_ + j];
+  internal::Sub(matrix_.data(), other.matrix_.data(), matrix_.size());
 }
 
-void Matrix::MulNumber(const double num) {
-  for (int i = 0; i < rows_; i++)
-    for (int j = 0; j < cols_; j++) matrix_[i * cols_ + j] *= num;
+template <typename T>
+void BasicMatrix<T>::MulNumber(const T num) {
+  XMATRIX_INSTRUMENT(kMulNumber, matrix_.size());
+  internal::Scale(matrix_.data(), num, matrix_.size());
 }
 
-void Matrix::MulMatrix(const Matrix& other) {
-  if (rows_ != other.cols_) {
+template <typename T>
+void BasicMatrix<T>::MulMatrix(const BasicMatrix& other) {
+  XMATRIX_INSTRUMENT(kMulMatrix, 2ull * rows_ * cols_ * other.cols_);
+  if (cols_ != other.rows_) {
     throw std::invalid_argument(
         "Num of cols in the first matrix must be equal the num of rows in the "
         "second matrix");
   }
 
-  Matrix result(rows_, other.cols_);
-
-  for (int i = 0; i < result.rows_; i++)
-    for (int j = 0; j < result.cols_; j++)
-      for (int f = 0; f < cols_; f++)
-        result.matrix_[i * result.cols_ + j] +=
-            matrix_[i * cols_ + f] * other.matrix_[f * other.cols_ + j];
+  // The product cannot overwrite its own operand, so it goes through a
+  // scratch buffer and is copied back into the storage this matrix owns.
+  BasicMatrix<T> product(rows_, other.cols_, internal::ScratchResource());
+  internal::Gemm<T>(*this, other, product);
+  *this = product;
+}
 
-  *this = std::move(result);
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::Transpose() const {
+  XMATRIX_INSTRUMENT(kTranspose, 0);
+  return BasicMatrix(TransposeView());
 }
 
-Matrix Matrix::Transpose() const {
-  Matrix result(cols_, rows_);
+template <typename T>
+void BasicMatrix<T>::TransposeInPlace() {
+  XMATRIX_INSTRUMENT(kTransposeInPlace, 0);
+  T* a = matrix_.data();
+
+  if (rows_ == cols_) {
+    // Swapping whole blocks keeps both the block and its mirror in cache.
+    constexpr int kBlock = 32;
+    const int n = rows_;
+
+    for (int ib = 0; ib < n; ib += kBlock) {
+      const int ie = std::min(n, ib + kBlock);
+      for (int jb = ib; jb < n; jb += kBlock) {
+        const int je = std::min(n, jb + kBlock);
+        for (int i = ib; i < ie; i++)
+          for (int j = std::max(jb, i + 1); j < je; j++)
+            std::swap(a[i * n + j], a[j * n + i]);
+      }
+    }
+    return;
+  }
 
-  for (int i = 0; i < cols_; i++)
-    for (int j = 0; j < rows_; j++) result(i, j) = (*this)(j, i);
+  // Element k = i * cols + j moves to j * rows + i, which is k * rows modulo
+  // size - 1. Each permutation cycle is rotated once; the visited bits cost
+  // one bit per element instead of a second copy of the matrix.
+  const size_t size = matrix_.size();
+  const size_t last = size - 1;
+  std::vector<bool> visited(size);
+
+  for (size_t start = 1; start < last; start++) {
+    if (visited[start]) continue;
+
+    T carried = a[start];
+    size_t k = start;
+    do {
+      k = k * rows_ % last;
+      std::swap(carried, a[k]);
+      visited[k] = true;
+    } while (k != start);
+  }
 
-  return result;
+  std::swap(rows_, cols_);
 }
 
-Matrix Matrix::CalcComplements() const {
-  Matrix result(rows_, cols_);
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::CalcComplements() const {
+  // One (n-1) x (n-1) LU per element.
+  XMATRIX_INSTRUMENT(kCalcComplements, 2ull * rows_ * cols_ * (rows_ - 1) *
+                                           (rows_ - 1) * (rows_ - 1) / 3);
+  BasicMatrix<T> result(rows_, cols_);
 
   if (this->rows_ == 1) {
     result.matrix_[0] = 1;
   } else {
-    Matrix minor(rows_ - 1, cols_ - 1);
+    BasicMatrix<T> minor(rows_ - 1, cols_ - 1, internal::ScratchResource());
 
     for (int i = 0; i < rows_; i++) {
       for (int j = 0; j < cols_; j++) {
         MinorMatrix(minor, i, j);
-        const double det = minor.Determinant();
-        const double sign = (i + j) % 2 == 0 ? 1 : -1;
+        const T det = minor.Determinant();
+        const T sign = (i + j) % 2 == 0 ? 1 : -1;
         result.matrix_[i * cols_ + j] = sign * det;
       }
     }
@@ -188,8 +419,9 @@ Matrix Matrix::CalcComplements() const {
   return result;
 }
 
-void Matrix::MinorMatrix(Matrix& minor, const int using_row,
-                         const int using_col) const {
+template <typename T>
+void BasicMatrix<T>::MinorMatrix(BasicMatrix& minor, const int using_row,
+                                 const int using_col) const {
   int i, j, k, l;
 
   for (i = 0, k = 0; k < minor.rows_; i++) {
@@ -206,121 +438,450 @@ void Matrix::MinorMatrix(Matrix& minor, const int using_row,
   }
 }
 
-double Matrix::Determinant() const {
-  double result = 0;
-
+template <typename T>
+T BasicMatrix<T>::Determinant() const {
+  XMATRIX_INSTRUMENT(kDeterminant, 2ull * rows_ * rows_ * rows_ / 3);
   if (rows_ < 1 || rows_ != cols_) {
     throw std::invalid_argument("Incorrect size");
   }
 
-  if (rows_ == 1) {
-    result = matrix_[0];
-  } else if (rows_ == 2) {
-    result = matrix_[0] * matrix_[3] - matrix_[1] * matrix_[2];
-  } else {
-    double temp_result = 0;
-    char minus_flag = 1;
-    Matrix minor(rows_ - 1, cols_ - 1);
+  if (rows_ == 1) return matrix_[0];
+  if (rows_ == 2) return matrix_[0] * matrix_[3] - matrix_[1] * matrix_[2];
 
-    for (int i = 0; i < rows_; i++) {
-      MinorMatrix(minor, 0, i);
-      temp_result = minor.Determinant();
-      result += temp_result * minus_flag * matrix_[i]; // 0 * cols_ + i
-      minus_flag = -minus_flag;
-    }
-  }
+  // Only the diagonal of U and the permutation sign are needed, so the
+  // factors live in scratch memory and no permutation is recorded.
+  BasicMatrix<T> lu(rows_, cols_, internal::ScratchResource());
+  lu.matrix_.assign(matrix_.begin(), matrix_.end());
+
+  int sign = 1;
+  if (FactorLU(lu.matrix_.data(), rows_, nullptr, sign)) return 0.0;
+
+  T result = sign;
+  for (int i = 0; i < rows_; i++) result *= lu.matrix_[i * cols_ + i];
 
   return result;
 }
 
-Matrix Matrix::InverseMatrix() const {
-  Matrix result(rows_, cols_);
-
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::InverseMatrix() const {
+  XMATRIX_INSTRUMENT(kInverseMatrix, 8ull * rows_ * rows_ * rows_ / 3);
   if (matrix_.empty() || rows_ < 1 || rows_ != cols_) {
     throw std::invalid_argument("Incorrect values.");
   }
 
-  if (rows_ == 1) {
-    result.matrix_[0] = 1 / matrix_[0];
-  } else {
-    double det = 0;
-    det = this->Determinant();
+  const int n = rows_;
+  BasicMatrix<T> lu(n, n, internal::ScratchResource());
+  lu.matrix_.assign(matrix_.begin(), matrix_.end());
+  std::pmr::vector<int> perm(n, internal::ScratchResource());
 
-    if (det != 0.0) {
-      Matrix temp1(rows_, cols_);
+  int sign = 1;
+  if (FactorLU(lu.matrix_.data(), n, perm.data(), sign)) {
+    throw std::invalid_argument("Determinant is equal to zero");
+  }
 
-      temp1 = this->CalcComplements();
+  // Solving L * U * X = P * I row by row keeps every update contiguous.
+  BasicMatrix<T> result(n, n);
+  for (int i = 0; i < n; i++) result.matrix_[i * n + perm[i]] = 1.0;
+  SubstituteLU(lu.matrix_.data(), n, result.matrix_.data(), n);
 
-      result = temp1.Transpose();
-      result.MulNumber(1 / det);
-    } else {
-      throw std::invalid_argument("Determinant is equal to zero");
-    }
+  return result;
+}
+
+template <typename T>
+BasicLUDecomposition<T> BasicMatrix<T>::LU() const {
+  XMATRIX_INSTRUMENT(kLU, 2ull * rows_ * rows_ * rows_ / 3);
+  return BasicLUDecomposition<T>(*this);
+}
+
+// LU DECOMPOSITION
+template <typename T>
+BasicLUDecomposition<T>::BasicLUDecomposition(const BasicMatrix<T>& a)
+    : lu_(a), perm_(a.rows_), sign_(1), singular_(false), norm1_(0.0) {
+  XMATRIX_INSTRUMENT(kLU, 2ull * a.rows_ * a.rows_ * a.rows_ / 3);
+  if (a.rows_ != a.cols_) {
+    throw std::invalid_argument("Incorrect size");
+  }
+
+  const int n = lu_.rows_;
+  const T* m = lu_.matrix_.data();
+
+  for (int j = 0; j < n; j++) {
+    internal::RealType<T> column_sum = 0;
+    for (int i = 0; i < n; i++) column_sum += std::abs(m[i * n + j]);
+    norm1_ = std::max(norm1_, column_sum);
+  }
+
+  singular_ = FactorLU(lu_.matrix_.data(), n, perm_.data(), sign_);
+}
+
+template <typename T>
+int BasicLUDecomposition<T>::GetSize() const { return lu_.rows_; }
+
+template <typename T>
+BasicMatrix<T> BasicLUDecomposition<T>::GetL() const {
+  XMATRIX_INSTRUMENT(kLUFactors, 0);
+  const int n = lu_.rows_;
+  BasicMatrix<T> result(n, n);
+
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < i; j++)
+      result.matrix_[i * n + j] = lu_.matrix_[i * n + j];
+    result.matrix_[i * n + i] = 1.0;
   }
 
   return result;
 }
 
-// OVERLOAD FUNCTIONS
-Matrix Matrix::operator+(const Matrix& other) const {
-  Matrix result = other;
-  result.SumMatrix(*this);
+template <typename T>
+BasicMatrix<T> BasicLUDecomposition<T>::GetU() const {
+  XMATRIX_INSTRUMENT(kLUFactors, 0);
+  const int n = lu_.rows_;
+  BasicMatrix<T> result(n, n);
+
+  for (int i = 0; i < n; i++)
+    for (int j = i; j < n; j++)
+      result.matrix_[i * n + j] = lu_.matrix_[i * n + j];
+
   return result;
 }
 
-Matrix Matrix::operator-(const Matrix& other) const {
-  Matrix result = *this;
-  result.SubMatrix(other);
+template <typename T>
+BasicMatrix<T> BasicLUDecomposition<T>::GetP() const {
+  XMATRIX_INSTRUMENT(kLUFactors, 0);
+  const int n = lu_.rows_;
+  BasicMatrix<T> result(n, n);
+
+  for (int i = 0; i < n; i++) result.matrix_[i * n + perm_[i]] = 1.0;
+
   return result;
 }
 
-Matrix Matrix::operator*(const Matrix& other) const {
-  Matrix result = *this;
-  result.MulMatrix(other);
+template <typename T>
+const std::vector<int>& BasicLUDecomposition<T>::GetPermutation() const {
+  return perm_;
+}
+
+template <typename T>
+bool BasicLUDecomposition<T>::IsSingular() const { return singular_; }
+
+template <typename T>
+T BasicLUDecomposition<T>::Determinant() const {
+  XMATRIX_INSTRUMENT(kDeterminant, lu_.rows_);
+  if (singular_) return 0.0;
+
+  const int n = lu_.rows_;
+  T result = sign_;
+
+  for (int i = 0; i < n; i++) result *= lu_.matrix_[i * n + i];
+
+  return result;
+}
+
+template <typename T>
+BasicMatrix<T> BasicLUDecomposition<T>::Inverse() const {
+  XMATRIX_INSTRUMENT(kInverseMatrix, 2ull * lu_.rows_ * lu_.rows_ * lu_.rows_);
+  if (singular_) {
+    throw std::invalid_argument("Determinant is equal to zero");
+  }
+
+  // Solving L * U * X = P * I row by row keeps every update contiguous.
+  BasicMatrix<T> result = GetP();
+  SubstituteLU(lu_.matrix_.data(), lu_.rows_, result.matrix_.data(),
+               result.cols_);
+
+  return result;
+}
+
+template <typename T>
+BasicMatrix<T> BasicLUDecomposition<T>::Solve(const BasicMatrix<T>& b) const {
+  XMATRIX_INSTRUMENT(kSolve, 2ull * lu_.rows_ * lu_.rows_ * b.cols_);
+  const int n = lu_.rows_;
+
+  if (b.rows_ != n) {
+    throw std::invalid_argument(
+        "Num of rows in the right-hand side must be equal the matrix size");
+  }
+
+  if (singular_) {
+    throw std::invalid_argument("Determinant is equal to zero");
+  }
+
+  BasicMatrix<T> result(n, b.cols_);
+
+  for (int i = 0; i < n; i++)
+    std::copy_n(b.matrix_.data() + perm_[i] * b.cols_, b.cols_,
+                result.matrix_.data() + i * b.cols_);
+
+  SubstituteLU(lu_.matrix_.data(), lu_.rows_, result.matrix_.data(),
+               result.cols_);
+
+  return result;
+}
+
+template <typename T>
+internal::RealType<T> BasicLUDecomposition<T>::ReciprocalCondition() const {
+  // At most five iterations of four triangular solves.
+  XMATRIX_INSTRUMENT(kReciprocalCondition, 20ull * lu_.rows_ * lu_.rows_);
+  using internal::Conj;
+  using Real = internal::RealType<T>;
+
+  if (singular_) return 0;
+
+  const int n = lu_.rows_;
+  const T* m = lu_.matrix_.data();
+  std::pmr::vector<T> x(n, T(Real(1) / n), internal::ScratchResource());
+  std::pmr::vector<T> y(n, internal::ScratchResource());
+  std::pmr::vector<T> z(n, internal::ScratchResource());
+  Real inverse_norm = 0;
+
+  // Hager's estimate of ||A^-1||_1: a few O(n^2) solves, no inverse formed.
+  for (int iteration = 0; iteration < 5; iteration++) {
+    for (int i = 0; i < n; i++) y[i] = x[perm_[i]];
+    SubstituteLU(m, n, y.data(), 1);
+
+    inverse_norm = 0;
+    for (int i = 0; i < n; i++) {
+      const Real magnitude = std::abs(y[i]);
+      inverse_norm += magnitude;
+      // sign(y), which for complex entries is the unit number y / |y|.
+      if constexpr (internal::kIsComplex<T>) {
+        z[i] = magnitude == 0 ? T(1) : y[i] / magnitude;
+      } else {
+        z[i] = y[i] >= 0 ? T(1) : T(-1);
+      }
+    }
+
+    // z = A^-H * sign(y), with A^H = U^H * L^H * P.
+    for (int i = 0; i < n; i++) {
+      for (int k = 0; k < i; k++) z[i] -= Conj(m[k * n + i]) * z[k];
+      z[i] /= Conj(m[i * n + i]);
+    }
+    for (int i = n - 1; i >= 0; i--)
+      for (int k = i + 1; k < n; k++) z[i] -= Conj(m[k * n + i]) * z[k];
+    for (int i = 0; i < n; i++) y[perm_[i]] = z[i];
+
+    int best = 0;
+    Real dot = 0;
+    for (int i = 0; i < n; i++) {
+      dot += std::real(Conj(y[i]) * x[i]);
+      if (std::abs(y[i]) > std::abs(y[best])) best = i;
+    }
+
+    if (std::abs(y[best]) <= dot) break;
+
+    std::fill(x.begin(), x.end(), T());
+    x[best] = 1;
+  }
+
+  return 1 / (norm1_ * inverse_norm);
+}
+
+template <typename T>
+BasicMatrix<T> Solve(const BasicMatrix<T>& a, const BasicMatrix<T>& b) {
+  XMATRIX_INSTRUMENT(kSolve, 2ull * a.GetRows() * a.GetRows() *
+                                 (a.GetRows() / 3 + b.GetCols()));
+  return a.LU().Solve(b);
+}
+
+namespace {
+
+template <typename T>
+BasicMatrix<T> MulMatrixImpl(const BasicMatrixView<const T> a,
+                             const BasicMatrixView<const T> b) {
+  XMATRIX_INSTRUMENT(kMulMatrix,
+                     2ull * a.GetRows() * a.GetCols() * b.GetCols());
+
+  if (a.GetCols() != b.GetRows()) {
+    throw std::invalid_argument(
+        "Num of cols in the first matrix must be equal the num of rows in the "
+        "second matrix");
+  }
+
+  BasicMatrix<T> result(a.GetRows(), b.GetCols());
+  internal::Gemm<T>(a, b, result);
+
   return result;
 }
 
-Matrix Matrix::operator*(const double num) const {
-  Matrix result = *this;
-  result.MulNumber(num);
+}  // namespace
+
+#define XMATRIX_DEFINE_MUL_MATRIX(T)                                        \
+  BasicMatrix<T> MulMatrix(const BasicMatrixView<const T> a,                \
+                           const BasicMatrixView<const T> b) {              \
+    return MulMatrixImpl(a, b);                                             \
+  }
+XMATRIX_FOR_EACH_SCALAR(XMATRIX_DEFINE_MUL_MATRIX)
+#undef XMATRIX_DEFINE_MUL_MATRIX
+
+// MIXED PRECISION
+namespace {
+
+// Refinement normally converges in a handful of steps; a system still short
+// of double accuracy after this many is re-solved in double, as LAPACK's
+// dsgesv does.
+constexpr int kMaxRefinementSteps = 30;
+
+template <typename To, typename From>
+BasicMatrix<To> ConvertMatrix(const BasicMatrix<From>& m) {
+  BasicMatrix<To> result(m.GetRows(), m.GetCols());
+  std::transform(m.begin(), m.end(), result.begin(),
+                 [](const From value) { return static_cast<To>(value); });
   return result;
 }
 
-bool Matrix::operator==(const Matrix& other) const {
+}  // namespace
+
+MixedPrecisionSolution SolveMixedPrecision(const Matrix& a, const Matrix& b) {
+  XMATRIX_INSTRUMENT(kSolveMixedPrecision,
+                     2ull * a.GetRows() * a.GetRows() *
+                         (a.GetRows() / 3 + b.GetCols()));
+  const int n = a.GetRows();
+
+  if (n != a.GetCols()) {
+    throw std::invalid_argument("Incorrect size");
+  }
+
+  if (b.GetRows() != n) {
+    throw std::invalid_argument(
+        "Num of rows in the right-hand side must be equal the matrix size");
+  }
+
+  const int k = b.GetCols();
+  double a_norm = 0.0, a_max = 0.0;
+  for (int i = 0; i < n; i++) {
+    double row_sum = 0.0;
+    for (int j = 0; j < n; j++) {
+      const double value = std::fabs(a.UncheckedAt(i, j));
+      row_sum += value;
+      a_max = std::max(a_max, value);
+    }
+    a_norm = std::max(a_norm, row_sum);
+  }
+
+  int iterations = 0;
+
+  if (a_max <= std::numeric_limits<float>::max()) {
+    const BasicLUDecomposition<float> lu(ConvertMatrix<float>(a));
+
+    if (!lu.IsSingular()) {
+      Matrix x = ConvertMatrix<double>(lu.Solve(ConvertMatrix<float>(b)));
+      Matrix residual(n, k, internal::ScratchResource());
+      const double tolerance =
+          a_norm * std::numeric_limits<double>::epsilon() * std::sqrt(n);
+
+      for (;; iterations++) {
+        // residual = B - A * X, in double; this is what recovers the digits
+        // the float factors lose.
+        std::fill(residual.begin(), residual.end(), 0.0);
+        internal::Gemm<double>(a, x, residual);
+        bool converged = true;
+        for (int j = 0; j < k; j++) {
+          double r_norm = 0.0, x_norm = 0.0;
+          for (int i = 0; i < n; i++) {
+            double& r = residual.UncheckedAt(i, j);
+            r = b.UncheckedAt(i, j) - r;
+            r_norm = std::max(r_norm, std::fabs(r));
+            x_norm = std::max(x_norm, std::fabs(x.UncheckedAt(i, j)));
+          }
+          // Negated so that a NaN residual counts as not converged.
+          if (!(r_norm <= x_norm * tolerance)) converged = false;
+        }
+
+        if (converged) return {std::move(x), iterations, false};
+        if (iterations == kMaxRefinementSteps) break;
+
+        const BasicMatrix<float> correction =
+            lu.Solve(ConvertMatrix<float>(residual));
+        std::transform(correction.begin(), correction.end(), x.begin(),
+                       x.begin(), [](const float d, const double value) {
+                         return value + static_cast<double>(d);
+                       });
+      }
+    }
+  }
+
+  return {Solve(a, b), iterations, true};
+}
+
+// OVERLOAD FUNCTIONS
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::operator*(const BasicMatrix& other) const {
+  XMATRIX_INSTRUMENT(kMulMatrix, 2ull * rows_ * cols_ * other.cols_);
+  if (cols_ != other.rows_) {
+    throw std::invalid_argument(
+        "Num of cols in the first matrix must be equal the num of rows in the "
+        "second matrix");
+  }
+
+  BasicMatrix<T> result(rows_, other.cols_);
+
+  internal::Gemm<T>(*this, other, result);
+
+  return result;
+}
+
+template <typename T>
+bool BasicMatrix<T>::operator==(const BasicMatrix& other) const {
   return this->IsEqual(other);
 }
 
-Matrix& Matrix::operator=(const Matrix& other) {
-  this->Resize(other.rows_, other.cols_);
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator=(const BasicMatrix& other) {
+  XMATRIX_INSTRUMENT(kCopy, 0);
+  if (this == &other) return *this;
+
+  if (other.matrix_.empty()) {
+    throw std::invalid_argument("The input matrix is incorrect size");
+  }
+
+  // assign() keeps the current buffer whenever it is large enough.
+  matrix_.assign(other.matrix_.begin(), other.matrix_.end());
+  rows_ = other.rows_;
+  cols_ = other.cols_;
+
+  return *this;
+}
+
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator=(BasicMatrix&& other) noexcept {
+  XMATRIX_INSTRUMENT(kMove, 0);
+  if (this == &other) return *this;
 
-  for (int i = 0; i < other.rows_; i++)
-    for (int j = 0; j < other.cols_; j++)
-      matrix_[i * cols_ + j] = other.matrix_[i * cols_ + j];
+  matrix_ = std::move(other.matrix_);
+  rows_ = other.rows_;
+  cols_ = other.cols_;
+  other.rows_ = 0;
+  other.cols_ = 0;
 
   return *this;
 }
 
-Matrix& Matrix::operator+=(const Matrix& other) {
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator+=(const BasicMatrix& other) {
   this->SumMatrix(other);
   return *this;
 }
 
-Matrix& Matrix::operator-=(const Matrix& other) {
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator-=(const BasicMatrix& other) {
   this->SubMatrix(other);
   return *this;
 }
 
-Matrix& Matrix::operator*=(const Matrix& other) {
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator*=(const BasicMatrix& other) {
   this->MulMatrix(other);
   return *this;
 }
 
-Matrix& Matrix::operator*=(const double num) {
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator*=(const T num) {
   this->MulNumber(num);
   return *this;
 }
 
-double& Matrix::operator()(const int r, const int c) {
+template <typename T>
+T& BasicMatrix<T>::operator()(const int r, const int c) {
   if (r >= rows_ || c >= cols_ || r < 0 || c < 0) {
     throw std::invalid_argument("Incorrect index");
   }
@@ -328,7 +889,8 @@ double& Matrix::operator()(const int r, const int c) {
   return matrix_[r * cols_ + c];
 }
 
-const double& Matrix::operator()(int r, int c) const {
+template <typename T>
+const T& BasicMatrix<T>::operator()(int r, int c) const {
   if (r >= rows_ || c >= cols_ || r < 0 || c < 0) {
     throw std::invalid_argument("Incorrect index");
   }
@@ -337,19 +899,29 @@ const double& Matrix::operator()(int r, int c) const {
 }
 
 //  SUPPORT FUNCTION
-Matrix operator*(const double num, const Matrix& mat) {
-  Matrix result = mat * num;
-  return result;
-}
-
-void Matrix::PrintMatrix() const {
+template <typename T>
+void BasicMatrix<T>::PrintMatrix() const {
+  XMATRIX_INSTRUMENT(kPrintMatrix, 0);
+  // One flush for the whole matrix; WriteText() (text_io.h) is the fast,
+  // round-trip exact path for dumping large matrices.
   for (int i = 0; i < rows_; ++i) {
     for (int j = 0; j < cols_; ++j) {
       std::cout << matrix_[i * cols_ + j] << " ";
     }
 
-    std::cout << std::endl;
+    std::cout << '\n';
   }
+
+  std::cout.flush();
 }
 
-}  // namespace xMatrix
\ No newline at end of file
+// INSTANTIATIONS
+#define XMATRIX_INSTANTIATE_MATRIX(T)                                       \
+  template class BasicMatrix<T>;                                            \
+  template class BasicLUDecomposition<T>;                                   \
+  template BasicMatrix<T> Solve(const BasicMatrix<T>& a,                    \
+                                const BasicMatrix<T>& b);
+XMATRIX_FOR_EACH_SCALAR(XMATRIX_INSTANTIATE_MATRIX)
+#undef XMATRIX_INSTANTIATE_MATRIX
+
+}  // namespace xMatrix
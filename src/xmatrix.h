@@ -1,61 +1,237 @@
 #ifndef XMATRIX_H
 #define XMATRIX_H
 
+#include <cassert>
+#include <memory_resource>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#include "aligned_allocator.h"
+#include "matrix_view.h"
+#include "scalar_traits.h"
+#include "scratch_pool.h"
+#include "small_buffer.h"
+
 namespace xMatrix {
 
-constexpr double EPS = 1e-8;
+// Threads used by the parallel kernels. Defaults to the XMATRIX_NUM_THREADS
+// environment variable, or to the hardware concurrency when it is unset.
+void SetNumThreads(int n);
+[[nodiscard]] int GetNumThreads();
+
+template <typename T>
+class BasicLUDecomposition;
+
+namespace internal {
+
+// Specialised in matrix_expr.h for every lazily evaluated expression type.
+template <typename T>
+struct IsExpression : std::false_type {};
 
-class Matrix {
+template <typename E>
+using EnableIfExpression = std::enable_if_t<IsExpression<E>::value>;
+
+}  // namespace internal
+
+// Dense row-major matrix of T. The members are compiled once for each type in
+// XMATRIX_FOR_EACH_SCALAR (float, double, long double and the complex types);
+// Matrix is the double instantiation.
+template <typename T>
+class BasicMatrix {
  public:
-  using MatrixType = std::vector<double>;
+  using value_type = T;
+  // Matrices of up to kInlineElements elements (4x4 and smaller transforms)
+  // keep them inside the object and never touch the heap.
+  static constexpr int kInlineElements = 16;
+  using MatrixType = internal::SmallBuffer<T, kInlineElements>;
+  using iterator = T*;
+  using const_iterator = const T*;
 
-  Matrix();
-  Matrix(int rows, int cols);
-  Matrix(const Matrix& o);
-  Matrix(Matrix&& o) noexcept;
-  ~Matrix();
+  BasicMatrix();
+  BasicMatrix(int rows, int cols);
+  // Takes its storage from resource instead of the default memory resource;
+  // resizing keeps the resource, copies of the matrix do not.
+  BasicMatrix(int rows, int cols, std::pmr::memory_resource* resource);
+  BasicMatrix(const BasicMatrix& o);
+  BasicMatrix(BasicMatrix&& o) noexcept;
+  // Copies the elements of a view, e.g. Matrix(m.Block(0, 0, 2, 2)).
+  explicit BasicMatrix(BasicMatrixView<const T> view);
+  // Evaluates an element-wise expression such as A + B - C * 2.0 in one pass.
+  template <typename E, typename = internal::EnableIfExpression<E>>
+  BasicMatrix(const E& expr);  // NOLINT(google-explicit-constructor)
+  ~BasicMatrix();
 
   [[nodiscard]] int GetRows() const;
   [[nodiscard]] int GetCols() const;
+  [[nodiscard]] std::pmr::memory_resource* GetResource() const;
 
   void SetRows(int r);
   void SetCols(int c);
   void Resize(int r, int c);
 
-  [[nodiscard]] bool IsEqual(const Matrix& other) const;
-  void SumMatrix(const Matrix& other);
-  void SubMatrix(const Matrix& other);
-  void MulNumber(double num);
-  void MulMatrix(const Matrix& other);
-  [[nodiscard]] Matrix Transpose() const;
-  [[nodiscard]] Matrix CalcComplements() const;
-  [[nodiscard]] double Determinant() const;
-  [[nodiscard]] Matrix InverseMatrix() const;
-
-  Matrix operator-(const Matrix& other) const;
-  Matrix operator+(const Matrix& other) const;
-  Matrix operator*(const Matrix& other) const;
-  Matrix operator*(double num) const;
-  friend Matrix operator*(double num, const Matrix& mat);
-  bool operator==(const Matrix& other) const;
-  Matrix& operator=(const Matrix& other);
-  Matrix& operator+=(const Matrix& other);
-  Matrix& operator-=(const Matrix& other);
-  Matrix& operator*=(const Matrix& other);
-  Matrix& operator*=(double num);
-  double& operator()(int r, int c);
-  const double& operator()(int r, int c) const;
+  [[nodiscard]] bool IsEqual(const BasicMatrix& other) const;
+  void SumMatrix(const BasicMatrix& other);
+  void SubMatrix(const BasicMatrix& other);
+  void MulNumber(T num);
+  void MulMatrix(const BasicMatrix& other);
+  [[nodiscard]] BasicMatrix Transpose() const;
+  // Transposes without allocating a second matrix: square matrices swap
+  // blocks across the diagonal, rectangular ones follow permutation cycles.
+  void TransposeInPlace();
+  [[nodiscard]] BasicMatrix CalcComplements() const;
+  [[nodiscard]] T Determinant() const;
+  [[nodiscard]] BasicMatrix InverseMatrix() const;
+  [[nodiscard]] BasicLUDecomposition<T> LU() const;
+
+  // Zero-copy views; they stay valid until the matrix is resized or
+  // destroyed.
+  [[nodiscard]] BasicMatrixView<T> Block(int r, int c, int h, int w);
+  [[nodiscard]] BasicMatrixView<const T> Block(int r, int c, int h,
+                                               int w) const;
+  [[nodiscard]] BasicMatrixView<T> Row(int i);
+  [[nodiscard]] BasicMatrixView<const T> Row(int i) const;
+  [[nodiscard]] BasicMatrixView<T> Col(int j);
+  [[nodiscard]] BasicMatrixView<const T> Col(int j) const;
+  // Lazy O(1) transpose; unlike Transpose() nothing is copied.
+  [[nodiscard]] BasicMatrixView<T> TransposeView();
+  [[nodiscard]] BasicMatrixView<const T> TransposeView() const;
+  operator BasicMatrixView<T>();  // NOLINT(google-explicit-constructor)
+  operator BasicMatrixView<const T>() const;  // NOLINT
+
+  // operator+, operator- and scalar operator* build lazy expressions; see
+  // matrix_expr.h.
+  BasicMatrix operator*(const BasicMatrix& other) const;
+  bool operator==(const BasicMatrix& other) const;
+  BasicMatrix& operator=(const BasicMatrix& other);
+  BasicMatrix& operator=(BasicMatrix&& other) noexcept;
+  template <typename E, typename = internal::EnableIfExpression<E>>
+  BasicMatrix& operator=(const E& expr);
+  BasicMatrix& operator+=(const BasicMatrix& other);
+  template <typename E, typename = internal::EnableIfExpression<E>>
+  BasicMatrix& operator+=(const E& expr);
+  BasicMatrix& operator-=(const BasicMatrix& other);
+  template <typename E, typename = internal::EnableIfExpression<E>>
+  BasicMatrix& operator-=(const E& expr);
+  BasicMatrix& operator*=(const BasicMatrix& other);
+  BasicMatrix& operator*=(T num);
+  T& operator()(int r, int c);
+  const T& operator()(int r, int c) const;
+
+  // Unchecked access for hot loops. These are inline so loops over them
+  // vectorize; indices are only asserted, i.e. checked in debug builds.
+  T& UncheckedAt(const int r, const int c) {
+    assert(r >= 0 && r < rows_ && c >= 0 && c < cols_);
+    return matrix_[r * cols_ + c];
+  }
+  const T& UncheckedAt(const int r, const int c) const {
+    assert(r >= 0 && r < rows_ && c >= 0 && c < cols_);
+    return matrix_[r * cols_ + c];
+  }
+  // Elements are stored row by row with no padding: row r starts at
+  // data() + r * GetCols(). data() is kMatrixAlignment-aligned.
+  T* data() { return matrix_.data(); }
+  const T* data() const { return matrix_.data(); }
+  T* RowPtr(const int r) {
+    assert(r >= 0 && r < rows_);
+    return matrix_.data() + r * cols_;
+  }
+  const T* RowPtr(const int r) const {
+    assert(r >= 0 && r < rows_);
+    return matrix_.data() + r * cols_;
+  }
+  // Random-access iteration over all elements in row-major order.
+  iterator begin() { return matrix_.data(); }
+  iterator end() { return matrix_.data() + matrix_.size(); }
+  const_iterator begin() const { return matrix_.data(); }
+  const_iterator end() const { return matrix_.data() + matrix_.size(); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
 
   void PrintMatrix() const;
+  // Writes the matrix to a versioned binary file (see matrix_file.h). Load()
+  // reads it back, including files written in column-major order; to use a
+  // large file without reading it, map it with MappedMatrix instead.
+  void Save(const std::string& path) const;
+  [[nodiscard]] static BasicMatrix Load(const std::string& path);
 
  private:
   int rows_, cols_;
   MatrixType matrix_;
-  void MinorMatrix(Matrix& minor, int using_row, int using_col) const;
+  void MinorMatrix(BasicMatrix& minor, int using_row, int using_col) const;
+
+  friend class BasicLUDecomposition<T>;
+};
+
+using Matrix = BasicMatrix<double>;
+
+// LU factorization with partial pivoting: P * A = L * U.
+// L is unit lower triangular and U is upper triangular; both are kept packed
+// in a single n x n buffer, so the object can be stored and reused.
+template <typename T>
+class BasicLUDecomposition {
+ public:
+  explicit BasicLUDecomposition(const BasicMatrix<T>& a);
+
+  [[nodiscard]] int GetSize() const;
+  [[nodiscard]] BasicMatrix<T> GetL() const;
+  [[nodiscard]] BasicMatrix<T> GetU() const;
+  [[nodiscard]] BasicMatrix<T> GetP() const;
+  // perm[i] is the row of A that ended up in row i of L * U.
+  [[nodiscard]] const std::vector<int>& GetPermutation() const;
+
+  [[nodiscard]] bool IsSingular() const;
+  [[nodiscard]] T Determinant() const;
+  [[nodiscard]] BasicMatrix<T> Inverse() const;
+  // Solves A * X = B for an n x k right-hand side in O(n^2 * k).
+  [[nodiscard]] BasicMatrix<T> Solve(const BasicMatrix<T>& b) const;
+  // Estimate of 1 / cond_1(A) in [0, 1]; values near zero mean the solution
+  // of any system with this matrix loses about -log10(rcond) digits.
+  [[nodiscard]] internal::RealType<T> ReciprocalCondition() const;
+
+ private:
+  BasicMatrix<T> lu_;
+  std::vector<int> perm_;
+  int sign_;
+  bool singular_;
+  internal::RealType<T> norm1_;
 };
 
+using LUDecomposition = BasicLUDecomposition<double>;
+
+// Solves A * X = B without forming A^-1. Factor once with A.LU() and call
+// LUDecomposition::Solve() directly when A is reused.
+template <typename T>
+[[nodiscard]] BasicMatrix<T> Solve(const BasicMatrix<T>& a,
+                                   const BasicMatrix<T>& b);
+
+// Result of SolveMixedPrecision().
+struct MixedPrecisionSolution {
+  Matrix x;
+  // Refinement steps taken after the initial float solve.
+  int iterations;
+  // True when the float path gave up and X was solved in double instead.
+  bool used_double;
+};
+
+// Solves A * X = B to double accuracy while doing the O(n^3) factorization
+// in float: X is refined with residuals computed in double until every
+// column satisfies ||B - A * X|| <= ||X|| * ||A|| * eps * sqrt(n) (infinity
+// norms). A that is out of float range, singular in float, or too badly
+// conditioned for refinement to converge falls back to Solve(A, B).
+[[nodiscard]] MixedPrecisionSolution SolveMixedPrecision(const Matrix& a,
+                                                         const Matrix& b);
+
+// Returns a * b for views, so transposed operands are multiplied in place:
+// MulMatrix(a.TransposeView(), a) forms the normal-equation matrix A^T * A.
+#define XMATRIX_DECLARE_MUL_MATRIX(T)                                \
+  [[nodiscard]] BasicMatrix<T> MulMatrix(BasicMatrixView<const T> a, \
+                                         BasicMatrixView<const T> b);
+XMATRIX_FOR_EACH_SCALAR(XMATRIX_DECLARE_MUL_MATRIX)
+#undef XMATRIX_DECLARE_MUL_MATRIX
+
 }  // namespace xMatrix
+
+#include "matrix_expr.h"
+
 #endif  // XMATRIX_H
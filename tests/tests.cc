@@ -1,5 +1,27 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory_resource>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+
 #include <gtest/gtest.h>
 
+#include "fixed_matrix.h"
+#include "instrumentation.h"
+#include "matrix_file.h"
+#include "out_of_core.h"
+#include "sparse_matrix.h"
+#include "text_io.h"
+#include "transform.h"
 #include "xmatrix.h"
 
 // ReSharper disable CppNoDiscardExpression
@@ -341,7 +363,7 @@ TEST(xMatrixTest, MulMatrixValid) {
 // Unit test for MulMatrix function with invalid matrices
 TEST(xMatrixTest, MulMatrixInvalid) {
   Matrix mat1(2, 3);
-  Matrix mat2(3, 4);
+  Matrix mat2(4, 2);
 
   EXPECT_THROW(mat1.MulMatrix(mat2), std::invalid_argument);
 }
@@ -851,6 +873,1209 @@ TEST(xMatrixTest, FriendOperatorMul) {
   EXPECT_DOUBLE_EQ(result(2, 2), 22.5);
 }
 
+// Unit test for LU function reconstructing P * A = L * U
+TEST(xMatrixTest, LUReconstruction) {
+  Matrix mat(3, 3);
+  mat(0, 0) = 2.0;
+  mat(0, 1) = -1.0;
+  mat(0, 2) = 0.0;
+  mat(1, 0) = 4.0;
+  mat(1, 1) = 1.0;
+  mat(1, 2) = 3.0;
+  mat(2, 0) = -2.0;
+  mat(2, 1) = 5.0;
+  mat(2, 2) = 7.0;
+
+  const LUDecomposition lu = mat.LU();
+
+  EXPECT_FALSE(lu.IsSingular());
+  EXPECT_EQ(lu.GetSize(), 3);
+  EXPECT_EQ(lu.GetPermutation()[0], 1);
+  EXPECT_TRUE((lu.GetP() * mat).IsEqual(lu.GetL() * lu.GetU()));
+  EXPECT_DOUBLE_EQ(lu.Determinant(), mat.Determinant());
+}
+
+// Unit test for LU function with a singular matrix
+TEST(xMatrixTest, LUSingular) {
+  Matrix mat(3, 3);
+  mat(0, 0) = 1.0;
+  mat(0, 1) = 2.0;
+  mat(0, 2) = 3.0;
+  mat(1, 0) = 2.0;
+  mat(1, 1) = 4.0;
+  mat(1, 2) = 6.0;
+  mat(2, 0) = 1.0;
+  mat(2, 1) = 0.0;
+  mat(2, 2) = 1.0;
+
+  const LUDecomposition lu = mat.LU();
+
+  EXPECT_TRUE(lu.IsSingular());
+  EXPECT_DOUBLE_EQ(lu.Determinant(), 0.0);
+}
+
+// Unit test for LU function with a non-square matrix
+TEST(xMatrixTest, LUNonSquare) {
+  const Matrix mat(2, 3);
+
+  EXPECT_THROW(mat.LU(), std::invalid_argument);
+}
+
+// Unit test for Determinant function with a large matrix
+TEST(xMatrixTest, DeterminantLargeMatrix) {
+  constexpr int size = 60;
+
+  Matrix mat(size, size);
+  for (int i = 0; i < size; i++) {
+    mat(i, i) = i % 2 == 0 ? 2.0 : 0.5;
+    for (int j = i + 1; j < size; j++) mat(i, j) = 1.0;
+  }
+  // Swapping the first two rows only flips the sign.
+  for (int j = 0; j < size; j++) std::swap(mat(0, j), mat(1, j));
+
+  EXPECT_NEAR(mat.Determinant(), -1.0, 1e-9);
+}
+
+// Unit test for InverseMatrix function with a large matrix
+TEST(xMatrixTest, InverseMatrixLargeMatrix) {
+  constexpr int size = 64;
+
+  Matrix mat(size, size);
+  Matrix identity(size, size);
+  for (int i = 0; i < size; i++) {
+    for (int j = 0; j < size; j++) mat(i, j) = 1.0 / (1 + (i * 7 + j * 3) % 11);
+    mat(i, i) += size;
+    identity(i, i) = 1.0;
+  }
+
+  const Matrix inv_mat = mat.InverseMatrix();
+
+  EXPECT_TRUE((mat * inv_mat).IsEqual(identity));
+  EXPECT_TRUE((inv_mat * mat).IsEqual(identity));
+}
+
+// Unit test for ReciprocalCondition function
+TEST(xMatrixTest, LUReciprocalCondition) {
+  Matrix identity(3, 3);
+  identity(0, 0) = 1.0;
+  identity(1, 1) = 1.0;
+  identity(2, 2) = 1.0;
+
+  Matrix nearly_singular(2, 2);
+  nearly_singular(0, 0) = 1.0;
+  nearly_singular(0, 1) = 1.0;
+  nearly_singular(1, 0) = 1.0;
+  nearly_singular(1, 1) = 1.0 + 1e-10;
+
+  EXPECT_DOUBLE_EQ(identity.LU().ReciprocalCondition(), 1.0);
+  EXPECT_LT(nearly_singular.LU().ReciprocalCondition(), 1e-9);
+  EXPECT_FALSE(nearly_singular.LU().IsSingular());
+}
+
+// Unit test for Inverse function of a singular LU decomposition
+TEST(xMatrixTest, LUInverseSingular) {
+  Matrix mat(2, 2);
+  mat(0, 0) = 1.0;
+  mat(0, 1) = 2.0;
+  mat(1, 0) = 2.0;
+  mat(1, 1) = 4.0;
+
+  const LUDecomposition lu = mat.LU();
+
+  EXPECT_DOUBLE_EQ(lu.ReciprocalCondition(), 0.0);
+  EXPECT_THROW(lu.Inverse(), std::invalid_argument);
+}
+
+// Unit test for Solve function with a single right-hand side
+TEST(xMatrixTest, SolveSingleRightHandSide) {
+  Matrix a(3, 3);
+  a(0, 0) = 2.0;
+  a(0, 1) = 1.0;
+  a(0, 2) = -1.0;
+  a(1, 0) = -3.0;
+  a(1, 1) = -1.0;
+  a(1, 2) = 2.0;
+  a(2, 0) = -2.0;
+  a(2, 1) = 1.0;
+  a(2, 2) = 2.0;
+
+  Matrix b(3, 1);
+  b(0, 0) = 8.0;
+  b(1, 0) = -11.0;
+  b(2, 0) = -3.0;
+
+  const Matrix x = Solve(a, b);
+
+  EXPECT_EQ(x.GetRows(), 3);
+  EXPECT_EQ(x.GetCols(), 1);
+  EXPECT_NEAR(x(0, 0), 2.0, 1e-12);
+  EXPECT_NEAR(x(1, 0), 3.0, 1e-12);
+  EXPECT_NEAR(x(2, 0), -1.0, 1e-12);
+}
+
+// Unit test for Solve function reusing one factorization
+TEST(xMatrixTest, SolveMultipleRightHandSides) {
+  Matrix a(3, 3);
+  a(0, 0) = 0.0;
+  a(0, 1) = 2.0;
+  a(0, 2) = 1.0;
+  a(1, 0) = 1.0;
+  a(1, 1) = 1.0;
+  a(1, 2) = 0.0;
+  a(2, 0) = 3.0;
+  a(2, 1) = 0.0;
+  a(2, 2) = 4.0;
+
+  Matrix x(3, 3);
+  x(0, 0) = 1.0;
+  x(0, 1) = -2.0;
+  x(0, 2) = 7.0;
+  x(1, 0) = 0.5;
+  x(1, 1) = 3.0;
+  x(1, 2) = -1.0;
+  x(2, 0) = 4.0;
+  x(2, 1) = 0.0;
+  x(2, 2) = 2.5;
+
+  const LUDecomposition lu = a.LU();
+
+  EXPECT_TRUE(lu.Solve(a * x).IsEqual(x));
+  EXPECT_TRUE(lu.Solve(a * x * 2.0).IsEqual(x * 2.0));
+}
+
+// Unit test for Solve function with invalid arguments
+TEST(xMatrixTest, SolveInvalid) {
+  Matrix singular(2, 2);
+  singular(0, 0) = 1.0;
+  singular(0, 1) = 2.0;
+  singular(1, 0) = 2.0;
+  singular(1, 1) = 4.0;
+
+  EXPECT_THROW(Solve(singular, Matrix(2, 1)), std::invalid_argument);
+  EXPECT_THROW(Solve(Matrix(2, 3), Matrix(2, 1)), std::invalid_argument);
+  EXPECT_THROW(Solve(Matrix(3, 3), Matrix(2, 1)), std::invalid_argument);
+}
+
+// Unit test for MulMatrix function against the naive triple loop
+TEST(xMatrixTest, MulMatrixMatchesNaive) {
+  const int sizes[][3] = {{3, 5, 2}, {67, 45, 131}, {130, 611, 97}};
+
+  for (const auto& size : sizes) {
+    const int m = size[0], k = size[1], n = size[2];
+
+    Matrix a(m, k);
+    Matrix b(k, n);
+    for (int i = 0; i < m; i++)
+      for (int j = 0; j < k; j++) a(i, j) = ((i * 31 + j * 17) % 23) / 7.0 - 1;
+    for (int i = 0; i < k; i++)
+      for (int j = 0; j < n; j++) b(i, j) = ((i * 13 + j * 29) % 19) / 5.0 - 2;
+
+    Matrix expected(m, n);
+    for (int i = 0; i < m; i++)
+      for (int j = 0; j < n; j++)
+        for (int f = 0; f < k; f++) expected(i, j) += a(i, f) * b(f, j);
+
+    const Matrix result = a * b;
+
+    EXPECT_EQ(result.GetRows(), m);
+    EXPECT_EQ(result.GetCols(), n);
+    EXPECT_TRUE(result.IsEqual(expected));
+  }
+}
+
+// Unit test for MulMatrix function split across the thread pool
+TEST(xMatrixTest, MulMatrixMultithreaded) {
+  const int default_threads = GetNumThreads();
+  SetNumThreads(4);
+  EXPECT_EQ(GetNumThreads(), 4);
+
+  constexpr int size = 257;
+
+  Matrix a(size, size);
+  Matrix b(size, size);
+  for (int i = 0; i < size; i++) {
+    for (int j = 0; j < size; j++) {
+      a(i, j) = ((i + 3 * j) % 7) - 3.0;
+      b(i, j) = ((5 * i + j) % 11) * 0.5;
+    }
+  }
+
+  const Matrix parallel = a * b;
+  SetNumThreads(1);
+  const Matrix serial = a * b;
+  SetNumThreads(default_threads);
+
+  EXPECT_TRUE(parallel.IsEqual(serial));
+  EXPECT_THROW(SetNumThreads(0), std::invalid_argument);
+}
+
+// Unit test for element-wise functions on sizes that leave a SIMD tail
+TEST(xMatrixTest, ElementwiseOddSize) {
+  Matrix mat1(7, 13);
+  Matrix mat2(7, 13);
+  for (int i = 0; i < 7; i++) {
+    for (int j = 0; j < 13; j++) {
+      mat1(i, j) = i * 13 + j;
+      mat2(i, j) = 0.5 * j - i;
+    }
+  }
+
+  Matrix sum = mat1;
+  sum.SumMatrix(mat2);
+  Matrix diff = mat1;
+  diff.SubMatrix(mat2);
+  Matrix scaled = mat1;
+  scaled.MulNumber(-1.5);
+
+  for (int i = 0; i < 7; i++) {
+    for (int j = 0; j < 13; j++) {
+      EXPECT_DOUBLE_EQ(sum(i, j), mat1(i, j) + mat2(i, j));
+      EXPECT_DOUBLE_EQ(diff(i, j), mat1(i, j) - mat2(i, j));
+      EXPECT_DOUBLE_EQ(scaled(i, j), mat1(i, j) * -1.5);
+    }
+  }
+
+  Matrix almost = mat1;
+  almost(6, 12) += EPS / 2;
+  EXPECT_TRUE(mat1.IsEqual(almost));
+  almost(6, 12) += EPS;
+  EXPECT_FALSE(mat1.IsEqual(almost));
+  almost(6, 12) = mat1(6, 12);
+  almost(0, 3) -= 1.0;
+  EXPECT_FALSE(mat1.IsEqual(almost));
+}
+
+// Unit test for a chained element-wise expression
+TEST(xMatrixTest, ExpressionChain) {
+  Matrix a(2, 3);
+  Matrix b(2, 3);
+  Matrix c(2, 3);
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 3; j++) {
+      a(i, j) = i + j;
+      b(i, j) = 2.0 * j;
+      c(i, j) = i - 0.5 * j;
+    }
+  }
+
+  const Matrix result = a + b - c * 2.0;
+  Matrix assigned(2, 3);
+  assigned = 0.5 * (a - b) + c;
+
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 3; j++) {
+      EXPECT_DOUBLE_EQ(result(i, j), a(i, j) + b(i, j) - c(i, j) * 2.0);
+      EXPECT_DOUBLE_EQ(assigned(i, j), 0.5 * (a(i, j) - b(i, j)) + c(i, j));
+    }
+  }
+
+  EXPECT_TRUE(a + b == b + a);
+  EXPECT_THROW(a + Matrix(3, 2), std::invalid_argument);
+}
+
+// Unit test for expressions that alias or mix with matrix products
+TEST(xMatrixTest, ExpressionAliasingAndProduct) {
+  Matrix a(2, 2);
+  a(0, 0) = 1.0;
+  a(0, 1) = 2.0;
+  a(1, 0) = 3.0;
+  a(1, 1) = 4.0;
+
+  Matrix identity(2, 2);
+  identity(0, 0) = 1.0;
+  identity(1, 1) = 1.0;
+
+  const Matrix product = (a + identity) * (a - identity);
+
+  EXPECT_DOUBLE_EQ(product(0, 0), 6.0);
+  EXPECT_DOUBLE_EQ(product(0, 1), 10.0);
+  EXPECT_DOUBLE_EQ(product(1, 0), 15.0);
+  EXPECT_DOUBLE_EQ(product(1, 1), 21.0);
+
+  a = a + a * 2.0;
+  a += identity * 10.0;
+  a -= identity - identity;
+
+  EXPECT_DOUBLE_EQ(a(0, 0), 13.0);
+  EXPECT_DOUBLE_EQ(a(0, 1), 6.0);
+  EXPECT_DOUBLE_EQ(a(1, 0), 9.0);
+  EXPECT_DOUBLE_EQ(a(1, 1), 22.0);
+}
+
+// Unit test for operators reusing the buffer of a temporary operand
+TEST(xMatrixTest, RvalueOperatorsReuseBuffer) {
+  // Too large for the inline buffer, so the heap block can change hands.
+  Matrix a(5, 5);
+  a(0, 0) = 1.0;
+  a(0, 1) = 2.0;
+  a(1, 0) = 3.0;
+  a(1, 1) = 4.0;
+
+  Matrix temp = a * a;
+  const double* buffer = &temp(0, 0);
+  Matrix sum = std::move(temp) + a;
+  EXPECT_EQ(&sum(0, 0), buffer);
+  EXPECT_DOUBLE_EQ(sum(1, 1), 26.0);
+
+  Matrix diff = a - std::move(sum);
+  EXPECT_EQ(&diff(0, 0), buffer);
+  EXPECT_DOUBLE_EQ(diff(0, 0), -7.0);
+  EXPECT_DOUBLE_EQ(diff(1, 1), -22.0);
+
+  Matrix scaled = std::move(diff) * -1.0;
+  EXPECT_EQ(&scaled(0, 0), buffer);
+  EXPECT_DOUBLE_EQ(scaled(0, 1), 10.0);
+
+  Matrix both = std::move(scaled) + Matrix(a);
+  EXPECT_EQ(&both(0, 0), buffer);
+  EXPECT_DOUBLE_EQ(both(1, 0), 18.0);
+}
+
+// Unit test for copy and move assignment
+TEST(xMatrixTest, AssignmentKeepsBuffer) {
+  Matrix a(2, 2);
+  a(0, 1) = 5.0;
+
+  Matrix b(2, 2);
+  const double* buffer = &b(0, 0);
+  b = a;
+  EXPECT_EQ(&b(0, 0), buffer);
+  EXPECT_DOUBLE_EQ(b(0, 1), 5.0);
+
+  Matrix c(3, 1);
+  c = std::move(a);
+  EXPECT_EQ(c.GetRows(), 2);
+  EXPECT_EQ(c.GetCols(), 2);
+  EXPECT_DOUBLE_EQ(c(0, 1), 5.0);
+  EXPECT_EQ(a.GetRows(), 0);
+  EXPECT_THROW(b = a, std::invalid_argument);
+}
+
+// Unit test for FixedMatrix compile-time construction and access
+TEST(xMatrixTest, FixedMatrixConstexpr) {
+  constexpr FixedMatrix<2, 3> mat{1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+  constexpr FixedMatrix<3, 2> transposed = mat.Transpose();
+  constexpr FixedMatrix<2, 2> product = mat * transposed;
+  constexpr FixedMatrix<3, 3> identity = FixedMatrix<3, 3>::Identity();
+
+  static_assert(transposed(2, 1) == 6.0);
+  static_assert(product(0, 0) == 14.0 && product(1, 0) == 32.0);
+  static_assert(identity(1, 1) == 1.0 && identity(1, 2) == 0.0);
+  static_assert(FixedMatrix<2, 2>{1.0, 2.0, 3.0, 4.0}.Determinant() == -2.0);
+  static_assert(FixedMatrix<2, 2>{} == FixedMatrix<2, 2>{} * 3.0);
+
+  EXPECT_EQ(product.GetRows(), 2);
+  EXPECT_EQ(product.GetCols(), 2);
+}
+
+// Unit test for FixedMatrix determinant and inverse against Matrix
+TEST(xMatrixTest, FixedMatrixInverseMatchesMatrix) {
+  const FixedMatrix<4, 4> mat{2.0, -1.0, 0.5, 3.0, 1.0, 4.0,  -2.0, 0.0,
+                              0.0, 1.5,  3.0, 1.0, 5.0, -3.0, 1.0,  2.0};
+  const FixedMatrix<3, 3> mat3{2.0, 0.0, 1.0, 1.0, 3.0, -1.0, 4.0, 1.0, 1.0};
+
+  EXPECT_NEAR(mat.Determinant(), mat.ToMatrix().Determinant(), 1e-12);
+  EXPECT_NEAR(mat3.Determinant(), mat3.ToMatrix().Determinant(), 1e-12);
+  EXPECT_TRUE(mat.InverseMatrix().ToMatrix() == mat.ToMatrix().InverseMatrix());
+  EXPECT_TRUE(mat3.InverseMatrix().ToMatrix() ==
+              mat3.ToMatrix().InverseMatrix());
+  EXPECT_TRUE(mat * mat.InverseMatrix() == (FixedMatrix<4, 4>::Identity()));
+  EXPECT_TRUE((FixedMatrix<4, 4>(mat.ToMatrix()) == mat));
+
+  const FixedMatrix<2, 2> singular{1.0, 2.0, 2.0, 4.0};
+  EXPECT_THROW((void)singular.InverseMatrix(), std::invalid_argument);
+  EXPECT_THROW((FixedMatrix<2, 2>(Matrix(3, 3))), std::invalid_argument);
+}
+
+// Unit test for TransformPoints function with interleaved points
+TEST(xMatrixTest, TransformPointsInterleaved) {
+  Matrix m(4, 4);
+  m(0, 0) = 2.0;
+  m(1, 1) = 3.0;
+  m(2, 2) = 4.0;
+  m(0, 3) = 1.0;
+  m(1, 3) = -1.0;
+  m(3, 3) = 1.0;
+
+  const float xyz[] = {1.0f, 1.0f, 1.0f, 0.5f, -2.0f, 0.0f};
+  float transformed[6];
+  TransformPoints(m, xyz, 2, transformed);
+
+  EXPECT_FLOAT_EQ(transformed[0], 3.0f);
+  EXPECT_FLOAT_EQ(transformed[1], 2.0f);
+  EXPECT_FLOAT_EQ(transformed[2], 4.0f);
+  EXPECT_FLOAT_EQ(transformed[3], 2.0f);
+  EXPECT_FLOAT_EQ(transformed[4], -7.0f);
+  EXPECT_FLOAT_EQ(transformed[5], 0.0f);
+
+  // Projection that copies z into w.
+  Matrix projection(4, 4);
+  projection(0, 0) = 1.0;
+  projection(1, 1) = 1.0;
+  projection(2, 2) = 1.0;
+  projection(3, 2) = 1.0;
+
+  double xyzw[] = {2.0, 4.0, 2.0, 1.0};
+  TransformOptions options;
+  options.layout = PointLayout::kXYZW;
+  options.perspective_divide = true;
+  TransformPoints(projection, xyzw, 1, xyzw, options);
+
+  EXPECT_DOUBLE_EQ(xyzw[0], 1.0);
+  EXPECT_DOUBLE_EQ(xyzw[1], 2.0);
+  EXPECT_DOUBLE_EQ(xyzw[2], 1.0);
+  EXPECT_DOUBLE_EQ(xyzw[3], 2.0);
+
+  EXPECT_THROW(TransformPoints(Matrix(3, 3), xyz, 2, transformed),
+               std::invalid_argument);
+}
+
+// Unit test for TransformPoints function with separate coordinate arrays
+TEST(xMatrixTest, TransformPointsSoAParallel) {
+  const int default_threads = GetNumThreads();
+  SetNumThreads(4);
+
+  Matrix m(4, 4);
+  m(0, 1) = 1.0;
+  m(1, 0) = -1.0;
+  m(2, 2) = 0.5;
+  m(2, 3) = 2.0;
+  m(3, 3) = 1.0;
+
+  constexpr size_t count = 100003;
+  std::vector<double> x(count), y(count), z(count);
+  for (size_t i = 0; i < count; i++) {
+    x[i] = static_cast<double>(i);
+    y[i] = 1.0 - i;
+    z[i] = 2.0 * i;
+  }
+
+  std::vector<double> out_x(count), out_y(count), out_z(count);
+  TransformPoints(m, SoAPoints<const double>{x.data(), y.data(), z.data()},
+                  count,
+                  SoAPoints<double>{out_x.data(), out_y.data(), out_z.data()});
+  SetNumThreads(default_threads);
+
+  for (size_t i = 0; i < count; i++) {
+    ASSERT_DOUBLE_EQ(out_x[i], y[i]);
+    ASSERT_DOUBLE_EQ(out_y[i], -x[i]);
+    ASSERT_DOUBLE_EQ(out_z[i], 0.5 * z[i] + 2.0);
+  }
+}
+
+// Unit test for Block, Row and Col views sharing the matrix storage
+TEST(xMatrixTest, MatrixViews) {
+  Matrix mat(3, 4);
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 4; j++) mat(i, j) = i * 4 + j;
+
+  const MatrixView block = mat.Block(1, 1, 2, 3);
+  EXPECT_EQ(block.GetRows(), 2);
+  EXPECT_EQ(block.GetCols(), 3);
+  EXPECT_DOUBLE_EQ(block(0, 0), 5.0);
+  EXPECT_DOUBLE_EQ(block(1, 2), 11.0);
+
+  block(1, 1) = -1.0;
+  EXPECT_DOUBLE_EQ(mat(2, 2), -1.0);
+
+  const ConstMatrixView col = std::as_const(mat).Col(3);
+  EXPECT_EQ(col.GetRows(), 3);
+  EXPECT_DOUBLE_EQ(col(2, 0), 11.0);
+  EXPECT_DOUBLE_EQ(mat.Row(2).Block(0, 1, 1, 2)(0, 1), -1.0);
+
+  const Matrix copy(block);
+  EXPECT_EQ(copy.GetRows(), 2);
+  EXPECT_DOUBLE_EQ(copy(0, 2), 7.0);
+
+  EXPECT_THROW((void)mat.Block(2, 0, 2, 1), std::invalid_argument);
+  EXPECT_THROW((void)mat.Row(3), std::invalid_argument);
+  EXPECT_THROW(block(2, 0), std::invalid_argument);
+}
+
+// Unit test for arithmetic kernels taking views
+TEST(xMatrixTest, MatrixViewKernels) {
+  Matrix mat(4, 4);
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++) mat(i, j) = i - j;
+
+  // Strided and contiguous operands in the same call.
+  SumMatrix(mat.Col(0), mat.Col(1));
+  EXPECT_DOUBLE_EQ(mat(3, 0), 5.0);
+  SubMatrix(mat.Row(0), mat.Row(1));
+  EXPECT_DOUBLE_EQ(mat(0, 3), -1.0);
+  MulNumber(mat.Block(2, 2, 2, 2), 10.0);
+  EXPECT_DOUBLE_EQ(mat(3, 2), 10.0);
+  CopyMatrix(mat.Row(3), mat.Row(2));
+  EXPECT_TRUE(IsEqual(mat.Row(2), mat.Row(3)));
+  EXPECT_FALSE(IsEqual(mat.Row(1), mat.Row(3)));
+
+  Matrix product(2, 2);
+  MulMatrix(mat.Block(0, 0, 2, 4), mat.Block(0, 0, 4, 2), product);
+  const Matrix expected =
+      Matrix(mat.Block(0, 0, 2, 4)) * Matrix(mat.Block(0, 0, 4, 2));
+  EXPECT_TRUE(product.IsEqual(expected));
+  EXPECT_THROW(MulMatrix(mat, product, product), std::invalid_argument);
+}
+
+// Unit test for the lazy transpose view
+TEST(xMatrixTest, TransposeView) {
+  Matrix mat(2, 3);
+  for (int i = 0; i < 2; i++)
+    for (int j = 0; j < 3; j++) mat(i, j) = i * 3 + j;
+
+  MatrixView t = mat.TransposeView();
+  EXPECT_EQ(t.GetRows(), 3);
+  EXPECT_EQ(t.GetCols(), 2);
+  EXPECT_EQ(t.data(), mat.Row(0).data());
+  EXPECT_EQ(t(2, 1), 5);
+  EXPECT_TRUE(IsEqual(t.Transpose(), mat));
+
+  t(0, 1) = 42;
+  EXPECT_EQ(mat(1, 0), 42);
+  EXPECT_TRUE(Matrix(t).IsEqual(mat.Transpose()));
+}
+
+// Unit test for products with transposed operands
+TEST(xMatrixTest, MulMatrixTransposed) {
+  const int sizes[][3] = {{3, 5, 2}, {67, 45, 131}};
+
+  for (const auto& size : sizes) {
+    const int m = size[0], k = size[1], n = size[2];
+
+    Matrix a(m, k);
+    Matrix b(k, n);
+    for (int i = 0; i < m; i++)
+      for (int j = 0; j < k; j++) a(i, j) = ((i * 31 + j * 17) % 23) / 7.0 - 1;
+    for (int i = 0; i < k; i++)
+      for (int j = 0; j < n; j++) b(i, j) = ((i * 13 + j * 29) % 19) / 5.0 - 2;
+
+    const Matrix at = a.Transpose();
+    const Matrix bt = b.Transpose();
+    const Matrix expected = a * b;
+
+    EXPECT_TRUE(MulMatrix(at.TransposeView(), b).IsEqual(expected));
+    EXPECT_TRUE(MulMatrix(a, bt.TransposeView()).IsEqual(expected));
+    EXPECT_TRUE(
+        MulMatrix(at.TransposeView(), bt.TransposeView()).IsEqual(expected));
+
+    Matrix ct(n, m);
+    MulMatrix(a, b, ct.TransposeView());
+    EXPECT_TRUE(ct.IsEqual(expected.Transpose()));
+  }
+
+  Matrix a(3, 2);
+  EXPECT_THROW(MulMatrix(a, a), std::invalid_argument);
+  EXPECT_EQ(MulMatrix(a.TransposeView(), a).GetRows(), 2);
+}
+
+// Unit test for blocked and in-place transposes of odd-sized matrices
+TEST(xMatrixTest, TransposeLarge) {
+  const int sizes[][2] = {{1, 7}, {37, 37}, {67, 130}, {130, 67}};
+
+  for (const auto& size : sizes) {
+    const int rows = size[0], cols = size[1];
+
+    Matrix mat(rows, cols);
+    for (int i = 0; i < rows; i++)
+      for (int j = 0; j < cols; j++) mat(i, j) = i * 1000 + j;
+
+    Matrix expected(cols, rows);
+    for (int i = 0; i < rows; i++)
+      for (int j = 0; j < cols; j++) expected(j, i) = mat(i, j);
+
+    EXPECT_TRUE(mat.Transpose().IsEqual(expected));
+
+    Matrix copied(cols, rows);
+    CopyMatrix(mat.TransposeView(), copied);
+    EXPECT_TRUE(copied.IsEqual(expected));
+
+    Matrix scattered(cols, rows);
+    CopyMatrix(mat, scattered.TransposeView());
+    EXPECT_TRUE(scattered.IsEqual(expected));
+
+    mat.TransposeInPlace();
+    EXPECT_EQ(mat.GetRows(), cols);
+    EXPECT_EQ(mat.GetCols(), rows);
+    EXPECT_TRUE(mat.IsEqual(expected));
+  }
+}
+
+// Unit test for unchecked access, raw pointers and iterators
+TEST(xMatrixTest, UncheckedAccess) {
+  Matrix mat(3, 4);
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 4; j++) mat.UncheckedAt(i, j) = i * 4 + j;
+
+  EXPECT_EQ(mat(2, 3), 11);
+  EXPECT_EQ(mat.data(), &mat(0, 0));
+  EXPECT_EQ(mat.RowPtr(2), &mat(2, 0));
+  EXPECT_EQ(mat.end() - mat.begin(), 12);
+
+  double expected = 0;
+  for (const double x : mat) EXPECT_EQ(x, expected++);
+
+  std::fill(mat.begin(), mat.end(), 2.0);
+  const Matrix& cmat = mat;
+  EXPECT_EQ(std::accumulate(cmat.cbegin(), cmat.cend(), 0.0), 24.0);
+  EXPECT_EQ(cmat.UncheckedAt(1, 1), 2.0);
+  EXPECT_EQ(cmat.RowPtr(1)[3], 2.0);
+}
+
+// Unit test for aligned storage taken from a memory resource
+TEST(xMatrixTest, MemoryResource) {
+  std::pmr::monotonic_buffer_resource arena;
+
+  Matrix mat(3, 5, &arena);
+  EXPECT_EQ(mat.GetResource(), &arena);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(mat.data()) % kMatrixAlignment,
+            0u);
+  mat(2, 4) = 7;
+
+  mat.Resize(4, 6);
+  EXPECT_EQ(mat.GetResource(), &arena);
+  EXPECT_EQ(mat(2, 4), 7);
+
+  const Matrix copy = mat;
+  EXPECT_EQ(copy.GetResource(), std::pmr::get_default_resource());
+  EXPECT_TRUE(copy.IsEqual(mat));
+
+  const Matrix moved = std::move(mat);
+  EXPECT_EQ(moved.GetResource(), &arena);
+  EXPECT_EQ(moved(2, 4), 7);
+
+  for (int n = 1; n < 9; n++) {
+    const Matrix small(1, n);
+    EXPECT_EQ(
+        reinterpret_cast<std::uintptr_t>(small.data()) % kMatrixAlignment, 0u);
+  }
+}
+
+// Unit test for temporaries recycled through the scratch pool
+TEST(xMatrixTest, ScratchPoolReuse) {
+  Matrix mat(6, 6);
+  for (int i = 0; i < 6; i++)
+    for (int j = 0; j < 6; j++)
+      mat(i, j) = (i == j ? 10 : 0) + (i * 7 + j) % 5;
+  const Matrix other = mat;
+
+  // Warm up, then every temporary must come from the pool.
+  (void)mat.Determinant();
+  (void)mat.InverseMatrix();
+  (void)mat.CalcComplements();
+  mat.MulMatrix(other);
+  const ScratchStats warm = GetScratchStats();
+
+  for (int i = 0; i < 3; i++) {
+    (void)mat.Determinant();
+    (void)mat.InverseMatrix();
+    (void)mat.CalcComplements();
+    mat.MulMatrix(other);
+    mat.MulNumber(1e-3);
+  }
+  const ScratchStats steady = GetScratchStats();
+
+  EXPECT_EQ(steady.misses, warm.misses);
+  EXPECT_GT(steady.hits, warm.hits);
+  EXPECT_GT(steady.bytes_cached, 0u);
+
+  ReleaseScratch();
+  EXPECT_EQ(GetScratchStats().bytes_cached, 0u);
+  EXPECT_EQ(GetScratchStats().hits, 0u);
+
+  // A buffer over the cache limit goes straight back upstream.
+  std::pmr::memory_resource* scratch = internal::ScratchResource();
+  void* big = scratch->allocate(kScratchCacheLimit + 1);
+  scratch->deallocate(big, kScratchCacheLimit + 1);
+  EXPECT_EQ(GetScratchStats().bytes_cached, 0u);
+}
+
+// Unit test for matrices small enough to live inside the object
+TEST(xMatrixTest, SmallMatrixInline) {
+  // Any heap allocation from these matrices would throw.
+  std::pmr::memory_resource* previous =
+      std::pmr::set_default_resource(std::pmr::null_memory_resource());
+
+  Matrix transform(4, 4);
+  for (int i = 0; i < 4; i++) transform(i, i) = 2.0;
+  Matrix copy = transform;
+  Matrix moved = std::move(copy);
+  Matrix product = transform * moved;
+  Matrix by_default;
+  const double det = product.Determinant();
+
+  std::pmr::set_default_resource(previous);
+
+  EXPECT_EQ(moved(3, 3), 2.0);
+  EXPECT_EQ(product(2, 2), 4.0);
+  EXPECT_EQ(by_default.GetRows(), 3);
+  EXPECT_DOUBLE_EQ(det, 256.0);
+
+  // Growing past the inline capacity spills to the heap and keeps the data.
+  Matrix grown = product;
+  grown.Resize(5, 5);
+  EXPECT_EQ(grown(2, 2), 4.0);
+  grown.Resize(2, 2);
+  EXPECT_EQ(grown(1, 1), 4.0);
+}
+
+// Unit test for float, long double and complex element types
+TEST(xMatrixTest, ScalarTypes) {
+  BasicMatrix<float> f(40, 40);
+  for (int i = 0; i < 40; i++)
+    for (int j = 0; j < 40; j++) f(i, j) = i == j ? 4.0F : 1.0F / (i + j + 1);
+  BasicMatrix<float> f2 = f * 2.0F + f;
+  EXPECT_FLOAT_EQ(f2(3, 3), 12.0F);
+  BasicMatrix<float> f_identity = f * f.InverseMatrix();
+  for (int i = 0; i < 40; i++)
+    EXPECT_NEAR(f_identity(i, i), 1.0F, kEpsilon<float>);
+  EXPECT_GT(f.LU().ReciprocalCondition(), 0.1F);
+
+  BasicMatrix<long double> l(3, 3);
+  l(0, 0) = 2, l(0, 1) = 1, l(1, 1) = 3, l(2, 0) = 1, l(2, 2) = 4;
+  EXPECT_NEAR(static_cast<double>(l.Determinant()), 24.0, 1e-12);
+  BasicMatrix<long double> identity = l * l.InverseMatrix();
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++)
+      EXPECT_NEAR(static_cast<double>(identity(i, j)), i == j ? 1.0 : 0.0,
+                  1e-15);
+
+  using Complex = std::complex<double>;
+  BasicMatrix<Complex> c(2, 2);
+  c(0, 0) = {0, 1}, c(0, 1) = 2, c(1, 0) = {1, -1}, c(1, 1) = {0, 3};
+  // det = i * 3i - 2 * (1 - i) = -5 + 2i
+  EXPECT_NEAR(std::abs(c.Determinant() - Complex(-5, 2)), 0.0, 1e-12);
+  BasicMatrix<Complex> x = Solve(c, c);
+  EXPECT_NEAR(std::abs(x(0, 0) - 1.0), 0.0, 1e-12);
+  EXPECT_NEAR(std::abs(x(1, 0)), 0.0, 1e-12);
+  BasicMatrix<Complex> sum = c + c * Complex(0, 1);
+  EXPECT_EQ(sum(0, 0), Complex(-1, 1));
+  EXPECT_TRUE(MulMatrix(c.TransposeView(), c).IsEqual(c.Transpose() * c));
+}
+
+// Unit test for the float-factor, double-refine solver
+TEST(xMatrixTest, SolveMixedPrecision) {
+  const int n = 60;
+  Matrix a(n, n), b(n, 2);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) a(i, j) = 1.0 / (i + 2 * j + 1);
+    a(i, i) += 3.0;
+    b(i, 0) = i % 7 - 3.0;
+    b(i, 1) = 1.0 / (i + 1);
+  }
+
+  const MixedPrecisionSolution refined = SolveMixedPrecision(a, b);
+  const Matrix expected = Solve(a, b);
+
+  EXPECT_FALSE(refined.used_double);
+  EXPECT_GT(refined.iterations, 0);
+  EXPECT_LT(refined.iterations, 10);
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < 2; j++)
+      EXPECT_NEAR(refined.x(i, j), expected(i, j), 1e-13);
+
+  // Hilbert matrices are far too ill-conditioned for float factors.
+  Matrix hilbert(12, 12), ones(12, 1);
+  for (int i = 0; i < 12; i++) {
+    for (int j = 0; j < 12; j++) hilbert(i, j) = 1.0 / (i + j + 1);
+    ones(i, 0) = 1.0;
+  }
+  const MixedPrecisionSolution fallback = SolveMixedPrecision(hilbert, ones);
+  EXPECT_TRUE(fallback.used_double);
+  EXPECT_TRUE(fallback.x.IsEqual(Solve(hilbert, ones)));
+
+  EXPECT_THROW(SolveMixedPrecision(Matrix(2, 3), Matrix(2, 1)),
+               std::invalid_argument);
+  EXPECT_THROW(SolveMixedPrecision(Matrix(2, 2), Matrix(3, 1)),
+               std::invalid_argument);
+}
+
+// Unit test for building and converting compressed sparse matrices
+TEST(xMatrixTest, SparseMatrixConversions) {
+  const SparseMatrix a = SparseMatrix::FromTriplets(
+      3, 4, {{2, 1, 5.0}, {0, 3, 1.0}, {0, 0, 2.0}, {2, 1, 1.0}, {1, 2, -4.0}});
+
+  EXPECT_EQ(a.GetNonZeros(), 4);
+  EXPECT_EQ(a.GetOffsets(), (std::vector<int>{0, 2, 3, 4}));
+  EXPECT_EQ(a.GetIndices(), (std::vector<int>{0, 3, 2, 1}));
+  EXPECT_EQ(a.At(2, 1), 6.0);
+  EXPECT_EQ(a.At(1, 1), 0.0);
+
+  const SparseMatrix csc = a.ToFormat(SparseFormat::kCsc);
+  EXPECT_EQ(csc.GetFormat(), SparseFormat::kCsc);
+  EXPECT_EQ(csc.GetOffsets(), (std::vector<int>{0, 1, 2, 3, 4}));
+  EXPECT_EQ(csc.GetIndices(), (std::vector<int>{0, 2, 1, 0}));
+  EXPECT_TRUE(csc == a);
+
+  const Matrix dense = a.ToMatrix();
+  EXPECT_EQ(dense(0, 3), 1.0);
+  EXPECT_EQ(dense(1, 0), 0.0);
+  EXPECT_TRUE(SparseMatrix(dense, SparseFormat::kCsc) == a);
+  EXPECT_TRUE(a.Transpose().ToMatrix().IsEqual(dense.Transpose()));
+
+  EXPECT_THROW(SparseMatrix(2, 2, SparseFormat::kCsr, {0, 2, 2}, {1, 0},
+                            {1.0, 2.0}),
+               std::invalid_argument);
+  EXPECT_THROW(SparseMatrix::FromTriplets(2, 2, {{2, 0, 1.0}}),
+               std::invalid_argument);
+  EXPECT_THROW((void)a.At(3, 0), std::invalid_argument);
+}
+
+// Unit test for sparse products and sums against their dense results
+TEST(xMatrixTest, SparseMatrixArithmetic) {
+  const int n = 300;
+  std::vector<SparseMatrix::Triplet> triplets;
+  for (int i = 0; i < n; i++) {
+    triplets.push_back({i, i, 4.0});
+    triplets.push_back({i, (i * 7 + 3) % n, 1.0 / (i + 1)});
+    triplets.push_back({(i * 13 + 5) % n, i, -2.0});
+  }
+  const SparseMatrix a = SparseMatrix::FromTriplets(n, n, triplets);
+  const SparseMatrix b = a.Transpose().ToFormat(SparseFormat::kCsr) * 0.5;
+  const Matrix da = a.ToMatrix(), db = b.ToMatrix();
+
+  Matrix x(n, 70);
+  std::vector<double> v(n);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < 70; j++) x(i, j) = (i + j) % 9 - 4.0;
+    v[i] = i % 5 - 2.0;
+  }
+
+  for (const SparseFormat format : {SparseFormat::kCsr, SparseFormat::kCsc}) {
+    const SparseMatrix fa = a.ToFormat(format);
+    EXPECT_TRUE((fa * x).IsEqual(da * x));
+    EXPECT_TRUE((fa * b).ToMatrix().IsEqual(da * db));
+    EXPECT_TRUE((fa + b).ToMatrix().IsEqual(da + db));
+    EXPECT_EQ((fa - fa).GetNonZeros(), 0);
+
+    const std::vector<double> y = fa * v;
+    Matrix column(n, 1);
+    for (int i = 0; i < n; i++) column(i, 0) = v[i];
+    const Matrix expected = da * column;
+    for (int i = 0; i < n; i++) EXPECT_NEAR(y[i], expected(i, 0), 1e-12);
+  }
+
+  EXPECT_THROW(a * Matrix(3, 3), std::invalid_argument);
+  EXPECT_THROW(a + SparseMatrix(3, 3), std::invalid_argument);
+
+  // CSC products large enough for the pool, with a dense operand narrower
+  // than one column slice, match their CSR counterparts.
+  const int default_threads = GetNumThreads();
+  SetNumThreads(4);
+  std::vector<SparseMatrix::Triplet> dense_triplets;
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+      if ((i * 31 + j * 17) % 5 != 0)
+        dense_triplets.push_back({i, j, i - j + 0.5});
+  const SparseMatrix csr = SparseMatrix::FromTriplets(n, n, dense_triplets);
+  const SparseMatrix csc = csr.ToFormat(SparseFormat::kCsc);
+  const Matrix narrow(x.Block(0, 0, n, 8));
+  EXPECT_TRUE((csc * narrow).IsEqual(csr * narrow));
+  EXPECT_TRUE((csc * x).IsEqual(csr * x));
+  const std::vector<double> y_csr = csr * v, y_csc = csc * v;
+  for (int i = 0; i < n; i++) EXPECT_NEAR(y_csc[i], y_csr[i], 1e-9);
+  SetNumThreads(default_threads);
+}
+
+// Unit test for saving, loading and mapping binary matrix files
+TEST(xMatrixTest, MatrixFileRoundTrip) {
+  const std::string path = ::testing::TempDir() + "xmatrix_file_test.bin";
+
+  Matrix m(37, 21);
+  for (int i = 0; i < 37; i++)
+    for (int j = 0; j < 21; j++) m(i, j) = 1.0 / (i + 1) - j * 0.1;
+  m.Save(path);
+
+  const Matrix loaded = Matrix::Load(path);
+  EXPECT_TRUE(std::equal(m.begin(), m.end(), loaded.begin(), loaded.end()));
+
+  {
+    const MappedMatrix mapped(path);
+    EXPECT_EQ(mapped.GetRows(), 37);
+    EXPECT_EQ(mapped.GetCols(), 21);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(mapped.View().data()) %
+                  kMatrixAlignment,
+              0U);
+    EXPECT_TRUE(IsEqual(mapped, m));
+    EXPECT_TRUE(MulMatrix(mapped.View().Transpose(), m)
+                    .IsEqual(m.Transpose() * m));
+  }
+
+  // With the shape swapped and the layout flag flipped, the same elements
+  // are the column-major encoding of the 21x37 transpose.
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    MatrixFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    std::swap(header.rows, header.cols);
+    header.layout = MatrixFileLayout::kColMajor;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+  EXPECT_TRUE(Matrix::Load(path).IsEqual(m.Transpose()));
+  EXPECT_TRUE(IsEqual(MappedMatrix(path), m.Transpose()));
+
+  // Room for the elements at any offset, but misaligned for doubles or with
+  // an alignment that is not a power of two.
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out |
+                                std::ios::ate);
+    file.write(std::string(64, '\0').data(), 64);
+  }
+  const auto set_offset = [&path](const std::uint64_t offset,
+                                  const std::uint32_t alignment) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    MatrixFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    header.data_offset = offset;
+    header.alignment = alignment;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  };
+  set_offset(68, 4);
+  EXPECT_THROW(Matrix::Load(path), std::invalid_argument);
+  EXPECT_THROW(MappedMatrix{path}, std::invalid_argument);
+  set_offset(72, 24);
+  EXPECT_THROW(Matrix::Load(path), std::invalid_argument);
+  EXPECT_THROW(MappedMatrix{path}, std::invalid_argument);
+  set_offset(72, 8);
+  EXPECT_EQ(Matrix::Load(path).GetRows(), 21);
+
+  BasicMatrix<std::complex<float>> c(2, 3);
+  c(1, 2) = {1.5F, -2.0F};
+  c.Save(path);
+  EXPECT_EQ(BasicMatrix<std::complex<float>>::Load(path)(1, 2), c(1, 2));
+  EXPECT_THROW(Matrix::Load(path), std::invalid_argument);
+  EXPECT_THROW(MappedMatrix{path}, std::invalid_argument);
+
+  std::remove(path.c_str());
+  EXPECT_THROW(Matrix::Load(path), std::system_error);
+  EXPECT_THROW(MappedMatrix{path}, std::system_error);
+}
+
+// Unit test for round-trip exact text writers and parsers
+TEST(xMatrixTest, TextRoundTrip) {
+  Matrix m(40, 13);
+  for (int i = 0; i < 40; i++)
+    for (int j = 0; j < 13; j++)
+      m(i, j) = (i - 20) / 3.0 * std::pow(10.0, j - 6);
+  m(0, 0) = 0.1 + 0.2;
+  m(1, 1) = -1e-300;
+
+  for (const char delimiter : {' ', ',', '\t'}) {
+    std::stringstream stream;
+    WriteText(m, stream, {delimiter});
+    const Matrix read = ReadText(stream, {delimiter});
+    EXPECT_TRUE(std::equal(m.begin(), m.end(), read.begin(), read.end()));
+  }
+
+  BasicMatrix<float> small(2, 2);
+  small(0, 1) = 0.1F;
+  small(1, 0) = -2.0F;
+  std::ostringstream small_text;
+  WriteText(small, small_text, {','});
+  EXPECT_EQ(small_text.str(), "0,0.1\n-2,0\n");
+
+  std::istringstream csv("1, 2.5,+3\r\n\n-4e2,5 ,  6\r\n");
+  const BasicMatrix<float> parsed = ReadText<float>(csv, {','});
+  EXPECT_EQ(parsed.GetRows(), 2);
+  EXPECT_EQ(parsed(0, 2), 3.0F);
+  EXPECT_EQ(parsed(1, 0), -400.0F);
+
+  std::istringstream ragged("1 2\n3\n");
+  EXPECT_THROW(ReadText(ragged), std::invalid_argument);
+  std::istringstream garbage("1 2x\n");
+  EXPECT_THROW(ReadText(garbage), std::invalid_argument);
+  std::istringstream empty_field("1,,2\n");
+  EXPECT_THROW(ReadText(empty_field, {','}), std::invalid_argument);
+  std::istringstream two_signs("1 +-2\n");
+  EXPECT_THROW(ReadText(two_signs), std::invalid_argument);
+  std::istringstream empty("");
+  EXPECT_THROW(ReadText(empty), std::invalid_argument);
+  std::istringstream blank_lines("\n  \r\n\n");
+  EXPECT_THROW(ReadText(blank_lines), std::invalid_argument);
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  const Matrix corner(m.Block(0, 0, 3, 3));
+  WriteText(corner, fds[1]);
+  close(fds[1]);
+  const Matrix from_pipe = ReadText(fds[0]);
+  EXPECT_TRUE(
+      std::equal(corner.begin(), corner.end(), from_pipe.begin(),
+                 from_pipe.end()));
+  close(fds[0]);
+}
+
+// Unit test for the tiled product of matrix files
+TEST(xMatrixTest, MulMatrixFiles) {
+  const std::string dir = ::testing::TempDir();
+  const std::string a_path = dir + "xmatrix_ooc_a.bin";
+  const std::string b_path = dir + "xmatrix_ooc_b.bin";
+  const std::string c_path = dir + "xmatrix_ooc_c.bin";
+
+  Matrix a(70, 53), b(53, 41);
+  for (int i = 0; i < 70; i++)
+    for (int j = 0; j < 53; j++) a(i, j) = (i * 7 + j * 3) % 11 - 5.0;
+  for (int i = 0; i < 53; i++)
+    for (int j = 0; j < 41; j++) b(i, j) = 1.0 / (i + j + 1);
+  a.Save(a_path);
+  b.Save(b_path);
+
+  // 16 KB holds tiles of about 20 elements a side, so the product runs in
+  // many steps, with partial tiles along every edge.
+  MulMatrixFiles(a_path, b_path, c_path, {16 << 10});
+  EXPECT_TRUE(Matrix::Load(c_path).IsEqual(a * b));
+
+  // A large budget takes everything in one step.
+  MulMatrixFiles(a_path, b_path, c_path);
+  EXPECT_TRUE(Matrix::Load(c_path).IsEqual(a * b));
+
+  // B stored column-major: the row-major file of B^T with the shape swapped.
+  b.Transpose().Save(b_path);
+  {
+    std::fstream file(b_path, std::ios::binary | std::ios::in | std::ios::out);
+    MatrixFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    std::swap(header.rows, header.cols);
+    header.layout = MatrixFileLayout::kColMajor;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+  MulMatrixFiles(a_path, b_path, c_path, {16 << 10});
+  EXPECT_TRUE(Matrix::Load(c_path).IsEqual(a * b));
+
+  EXPECT_THROW(MulMatrixFiles(a_path, a_path, c_path), std::invalid_argument);
+  // An output naming an input, even through another path, is rejected before
+  // the input is truncated.
+  const Matrix saved_a = Matrix::Load(a_path);
+  EXPECT_THROW(MulMatrixFiles(a_path, b_path, a_path), std::invalid_argument);
+  EXPECT_THROW(MulMatrixFiles(a_path, b_path, dir + "./xmatrix_ooc_b.bin"),
+               std::invalid_argument);
+  EXPECT_TRUE(Matrix::Load(a_path).IsEqual(saved_a));
+  EXPECT_THROW(MulMatrixFiles(a_path, b_path, c_path, {16}),
+               std::invalid_argument);
+  EXPECT_THROW(MulMatrixFiles<float>(a_path, b_path, c_path),
+               std::invalid_argument);
+
+  std::remove(a_path.c_str());
+  std::remove(b_path.c_str());
+  std::remove(c_path.c_str());
+}
+
+// Unit test for the operation counters and their snapshots
+TEST(xMatrixTest, Instrumentation) {
+  ResetInstrumentation();
+
+  const Matrix a(20, 20), b(20, 20);
+  const Matrix c = a * b;
+  EXPECT_EQ(c.Determinant(), 0.0);
+  std::thread([] { const Matrix m(30, 30); }).join();
+
+  InstrumentationSnapshot snapshot = GetInstrumentationSnapshot();
+  if (!kInstrumentationEnabled) {
+    for (const OperationStats& stats : snapshot.operations)
+      EXPECT_EQ(stats.calls, 0u);
+    return;
+  }
+
+  // The exited thread's construction is kept; the scratch matrix inside
+  // Determinant() is booked to Determinant, not to Construct.
+  EXPECT_EQ(snapshot[Operation::kConstruct].calls, 3u);
+  EXPECT_EQ(snapshot[Operation::kConstruct].bytes_allocated,
+            (2 * 400 + 900) * sizeof(double));
+
+  const OperationStats& product = snapshot[Operation::kMulMatrix];
+  EXPECT_EQ(product.calls, 1u);
+  EXPECT_EQ(product.flops, 2u * 20 * 20 * 20);
+  EXPECT_EQ(product.allocations, 1u);
+  EXPECT_EQ(product.bytes_allocated, 400 * sizeof(double));
+  EXPECT_EQ(std::accumulate(product.latency.begin(), product.latency.end(),
+                            std::uint64_t{0}),
+            1u);
+
+  EXPECT_EQ(snapshot[Operation::kDeterminant].calls, 1u);
+  EXPECT_EQ(snapshot[Operation::kDeterminant].allocations, 1u);
+  EXPECT_EQ(snapshot[Operation::kCopy].calls, 0u);
+
+  std::ostringstream dump;
+  DumpInstrumentation(dump);
+  EXPECT_NE(dump.str().find("MulMatrix calls=1 "), std::string::npos);
+
+  ResetInstrumentation();
+  snapshot = GetInstrumentationSnapshot();
+  for (const OperationStats& stats : snapshot.operations)
+    EXPECT_EQ(stats.calls, 0u);
+}
+
+// Unit test for calling Matrix methods on operator results
+TEST(xMatrixTest, ExpressionMethods) {
+  Matrix a(2, 2), b(2, 2);
+  a(0, 0) = 4.0;
+  a(0, 1) = 7.0;
+  a(1, 0) = 2.0;
+  a(1, 1) = 6.0;
+  b(0, 0) = 1.0;
+  b(1, 1) = 1.0;
+
+  const Matrix sum = a + b;
+  EXPECT_EQ((a + b)(0, 0), 5.0);
+  EXPECT_EQ((a - b)(1, 1), 5.0);
+  EXPECT_EQ((a * 2.0)(1, 0), 4.0);
+  EXPECT_THROW((void)(a + b)(2, 0), std::invalid_argument);
+  EXPECT_TRUE((a + b).IsEqual(sum));
+  EXPECT_TRUE((a + b).Transpose().IsEqual(sum.Transpose()));
+  EXPECT_DOUBLE_EQ((a * 2.0).Determinant(), 4.0 * a.Determinant());
+  EXPECT_TRUE((a - b).InverseMatrix().IsEqual((a - b).Eval().InverseMatrix()));
+  EXPECT_TRUE((a + b).CalcComplements().IsEqual(sum.CalcComplements()));
+  EXPECT_DOUBLE_EQ((a + b).LU().Determinant(), sum.Determinant());
+}
+
+// Unit test for Determinant with tiny but exact pivots
+TEST(xMatrixTest, DeterminantMixedScale) {
+  Matrix diag(3, 3);
+  diag(0, 0) = 1e-17;
+  diag(1, 1) = 1.0;
+  diag(2, 2) = 1.0;
+  EXPECT_DOUBLE_EQ(diag.Determinant(), 1e-17);
+  EXPECT_FALSE(diag.LU().IsSingular());
+
+  Matrix small(2, 2);
+  small(0, 0) = 1e-17;
+  small(1, 1) = 1.0;
+  EXPECT_DOUBLE_EQ(small.Determinant(), 1e-17);
+
+  diag(0, 2) = 5.0;
+  EXPECT_DOUBLE_EQ(diag.Determinant(), 1e-17);
+
+  // Singular only up to rounding, at any scale.
+  Matrix singular(3, 3);
+  std::iota(singular.begin(), singular.end(), 1.0);
+  singular.MulNumber(1e-20);
+  EXPECT_EQ(singular.Determinant(), 0.0);
+  EXPECT_TRUE(singular.LU().IsSingular());
+}
+
+// Unit test for inverting nonsingular matrices of mixed scale
+TEST(xMatrixTest, InverseMatrixMixedScale) {
+  Matrix mat(2, 2);
+  mat(0, 0) = 1e-17;
+  mat(1, 1) = 1.0;
+
+  const Matrix inverse = mat.InverseMatrix();
+  EXPECT_DOUBLE_EQ(inverse(0, 0), 1e17);
+  EXPECT_DOUBLE_EQ(inverse(1, 1), 1.0);
+  EXPECT_EQ(inverse(0, 1), 0.0);
+  EXPECT_DOUBLE_EQ(mat.LU().Inverse()(0, 0), 1e17);
+  // Ill-conditioning shows in the condition estimate instead.
+  EXPECT_LT(mat.LU().ReciprocalCondition(), 1e-16);
+
+  const FixedMatrix<2, 2> fixed{1e-17, 0.0, 0.0, 1.0};
+  EXPECT_DOUBLE_EQ(fixed.InverseMatrix()(0, 0), 1e17);
+  const FixedMatrix<3, 3> fixed3{1e-17, 0.0, 0.0, 0.0, 1.0, 0.0,
+                                 0.0,   0.0, 1.0};
+  EXPECT_DOUBLE_EQ(fixed3.InverseMatrix()(0, 0), 1e17);
+}
+
 /////////////////////////////////
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);